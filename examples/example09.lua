@@ -0,0 +1,140 @@
+----------------------------------------------------------------------------------------------------
+--[[
+     This example builds a processing graph of
+     [matrix mixer objects](https://github.com/osch/lua-ljack/blob/master/doc/README.md#client_new_matrix_mixer)
+     connected by [AUDIO process buffer objects](https://github.com/osch/lua-ljack/blob/master/doc/README.md#client_new_process_buffer)
+     and prints the processor statistics. It demonstrates:
+
+       * dependency ordering: the processors are created in reverse order, i.e. every
+         reader is registered before its writer, but they are invoked writer first without
+         adding latency.
+       * transactions: the whole graph becomes effective within one process cycle, see
+         [client:begin_transaction()](https://github.com/osch/lua-ljack/blob/master/doc/README.md#client_begin_transaction).
+       * shared process buffers: with the option *share_process_buffers* the buffers of
+         the chain share memory, because only two of them are live at the same time.
+--]]
+----------------------------------------------------------------------------------------------------
+
+local nocurses = require("nocurses") -- https://github.com/osch/lua-nocurses
+local carray   = require("carray")   -- https://github.com/osch/lua-carray
+local mtmsg    = require("mtmsg")    -- https://github.com/osch/lua-mtmsg
+local auproc   = require("auproc")   -- https://github.com/osch/lua-auproc
+local ljack    = require("ljack")
+
+----------------------------------------------------------------------------------------------------
+
+local pi       = math.pi
+local sin      = math.sin
+local format   = string.format
+
+local function printbold(...)
+    nocurses.setfontbold(true)
+    print(...)
+    nocurses.resetcolors()
+end
+
+----------------------------------------------------------------------------------------------------
+
+local CHAIN_LENGTH = 8
+
+local client = ljack.client_open("example09.lua", { share_process_buffers = true })
+client:activate()
+
+local myPort1    = client:port_register("audio-out1", "AUDIO", "OUT")
+local myPort2    = client:port_register("audio-out2", "AUDIO", "OUT")
+local otherPorts = client:get_ports(nil, "AUDIO", "IN")
+print("Connecting to", otherPorts[1], otherPorts[2])
+myPort1:connect(otherPorts[1])
+myPort2:connect(otherPorts[2])
+
+----------------------------------------------------------------------------------------------------
+
+local queue   = mtmsg.newbuffer()
+local qlength = 3
+queue:notifier(nocurses, "<", qlength)
+
+local chain = {}
+for i = 1, CHAIN_LENGTH do
+    chain[i] = client:new_process_buffer()
+end
+
+----------------------------------------------------------------------------------------------------
+
+client:begin_transaction()
+
+    -- output stage, reads the end of the chain
+    local outMixer = client:new_matrix_mixer({ chain[CHAIN_LENGTH] }, { myPort1, myPort2 })
+    outMixer:set_gain(1, 1, 1.0)
+    outMixer:set_gain(1, 2, 1.0)
+
+    -- chain of mixers, each one reads the output of the next one created
+    local mixers = {}
+    for i = CHAIN_LENGTH, 2, -1 do
+        mixers[i] = client:new_matrix_mixer({ chain[i - 1] }, { chain[i] })
+        mixers[i]:set_gain(1, 1, 1.0)
+    end
+
+    -- signal source, created last
+    local sender = auproc.new_audio_sender(chain[1], queue)
+
+    outMixer:activate()
+    for i = 2, CHAIN_LENGTH do
+        mixers[i]:activate()
+    end
+    sender:activate()
+
+client:commit_transaction()
+
+----------------------------------------------------------------------------------------------------
+
+local buflen    = client:get_buffer_size()
+local rate      = client:get_sample_rate()
+local samples   = carray.new("float", buflen)
+local frameTime = client:frame_time()
+
+local function printStats()
+    local stats = client:get_processor_stats(true)
+    local names = {}
+    for name in pairs(stats) do
+        names[#names + 1] = name
+    end
+    table.sort(names)
+    for _, name in ipairs(names) do
+        local s = stats[name]
+        print(format("%-30s count: %8d, mean: %8.2f us, max: %8.2f us", name, s.count, s.mean, s.max))
+    end
+end
+
+local function printHelp()
+    printbold("Press key p for printing processor statistics, q for Quit")
+end
+printHelp()
+
+----------------------------------------------------------------------------------------------------
+
+while true do
+    while queue:msgcnt() < qlength do
+        for i = 1, buflen do
+            local t = (frameTime + i)/rate
+            -- short beeps
+            local v = (t % 1.0 < 0.05) and 0.2*sin(t*440*2*pi) or 0
+            samples:set(i, v)
+        end
+        queue:addmsg(frameTime, samples)
+        frameTime = frameTime + buflen
+    end
+    local c = nocurses.getch()
+    if c then
+        c = string.char(c)
+        if c == "Q" or c == "q" then
+            printbold("Quit.")
+            break
+        elseif c == "p" then
+            printStats()
+        else
+            printHelp()
+        end
+    end
+end
+
+----------------------------------------------------------------------------------------------------
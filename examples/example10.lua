@@ -0,0 +1,115 @@
+----------------------------------------------------------------------------------------------------
+--[[
+     This example demonstrates a MIDI process buffer with multiple writers: two
+     [Auproc midi sender objects](https://github.com/osch/lua-auproc/blob/master/doc/README.md#auproc_new_midi_sender)
+     write into the same [MIDI process buffer](https://github.com/osch/lua-ljack/blob/master/doc/README.md#client_new_process_buffer)
+     and the events of both are merged in time order without an extra merging processor.
+     The merged events are printed by an
+     [Auproc midi receiver object](https://github.com/osch/lua-auproc/blob/master/doc/README.md#auproc_new_midi_receiver)
+     and are sent to a MIDI OUT port.
+
+     The client is opened with the option *min_sub_block_size*: processor objects that
+     declare the flag *AUPROC_PROC_SUB_BLOCKS* and read the merged process buffer are invoked
+     in sub-blocks beginning at the event times, see
+     [Processor Objects](https://github.com/osch/lua-ljack/blob/master/doc/README.md#processor-objects).
+--]]
+----------------------------------------------------------------------------------------------------
+
+local nocurses = require("nocurses") -- https://github.com/osch/lua-nocurses
+local carray   = require("carray")   -- https://github.com/osch/lua-carray
+local mtmsg    = require("mtmsg")    -- https://github.com/osch/lua-mtmsg
+local auproc   = require("auproc")   -- https://github.com/osch/lua-auproc
+local ljack    = require("ljack")
+
+----------------------------------------------------------------------------------------------------
+
+local format   = string.format
+local function printbold(...) nocurses.setfontbold(true) print(...) nocurses.resetcolors() end
+
+----------------------------------------------------------------------------------------------------
+
+local client = ljack.client_open("example10.lua", { min_sub_block_size = 16 })
+
+client:activate()
+
+local myMidiOutPort = client:port_register("midi_out", "MIDI", "OUT")
+local otherPorts    = client:get_ports(".*", "MIDI", "IN")
+if otherPorts[1] then
+    print("Connecting to", otherPorts[1])
+    myMidiOutPort:connect(otherPorts[1])
+end
+
+----------------------------------------------------------------------------------------------------
+
+local merged = client:new_process_buffer("MIDI", 2)  -- at most 2 writers
+
+local sender1Ctrl = mtmsg.newbuffer()
+local sender2Ctrl = mtmsg.newbuffer()
+local sender1     = auproc.new_midi_sender(merged, sender1Ctrl)
+local sender2     = auproc.new_midi_sender(merged, sender2Ctrl)
+
+local receivedEvents = mtmsg.newbuffer()
+receivedEvents:notifier(nocurses)
+local receiver  = auproc.new_midi_receiver(merged, receivedEvents)
+
+local mixerCtrl = mtmsg.newbuffer()
+local mixer     = auproc.new_midi_mixer(merged, myMidiOutPort, mixerCtrl)
+
+----------------------------------------------------------------------------------------------------
+
+client:begin_transaction()
+    sender1:activate()
+    sender2:activate()
+    receiver:activate()
+    mixer:activate()
+client:commit_transaction()
+
+----------------------------------------------------------------------------------------------------
+
+local NOTE_OFF = 0x8
+local NOTE_ON  = 0x9
+
+local function playNote(ctrl, channel, n)
+    ctrl:addmsg(string.char(NOTE_ON  * 0x10 + (channel - 1), n, 127))
+    ctrl:addmsg(string.char(NOTE_OFF * 0x10 + (channel - 1), n, 0))
+end
+
+local function printHelp()
+    printbold("Press key 1 or 2 for playing a note from sender 1 or sender 2, "
+            .."key b for both, q for Quit")
+end
+printHelp()
+
+----------------------------------------------------------------------------------------------------
+
+local midiBytes = carray.new("uint8")
+
+while true do
+    local c = nocurses.getch()
+    if c then
+        c = string.char(c)
+        if c == "Q" or c == "q" then
+            printbold("Quit.")
+            break
+        elseif c == "1" then
+            playNote(sender1Ctrl, 1, 60)
+        elseif c == "2" then
+            playNote(sender2Ctrl, 2, 67)
+        elseif c == "b" then
+            playNote(sender1Ctrl, 1, 60)
+            playNote(sender2Ctrl, 2, 67)
+        else
+            printHelp()
+        end
+    end
+    repeat
+        local frameTime = receivedEvents:nextmsg(0, midiBytes)
+        if frameTime then
+            local b0, b1, b2 = midiBytes:get(1, 3)
+            print(format("%11d %2d %-8s %3d %3d", frameTime, b0 % 0x10 + 1, 
+                         math.floor(b0 / 0x10) == NOTE_ON and "Note On" or "Note Off", b1, b2))
+        end
+    until not frameTime
+end
+
+----------------------------------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+----------------------------------------------------------------------------------------------------
+--[[
+     This example switches between two connection setups using
+     [client:apply_connections()](https://github.com/osch/lua-ljack/blob/master/doc/README.md#client_apply_connections):
+     only the connections that differ from the current state are disconnected or connected
+     and the changes are reported in one
+     [ConnectionsApplied](https://github.com/osch/lua-ljack/blob/master/doc/README.md#ConnectionsApplied)
+     status message instead of one PortConnect message per connection.
+
+     The example uses [lua-mtmsg](https://github.com/osch/lua-mtmsg) as receiver for
+     JACK status events, see also [Status Messages](https://github.com/osch/lua-ljack/blob/master/doc/README.md#status-messages).
+--]]
+----------------------------------------------------------------------------------------------------
+
+local nocurses = require("nocurses") -- https://github.com/osch/lua-nocurses
+local mtmsg    = require("mtmsg")    -- https://github.com/osch/lua-mtmsg
+local ljack    = require("ljack")
+
+----------------------------------------------------------------------------------------------------
+
+local format   = string.format
+local function printbold(...) nocurses.setfontbold(true) print(...) nocurses.resetcolors() end
+
+----------------------------------------------------------------------------------------------------
+
+local jackInfo = mtmsg.newbuffer() -- jack status callback messages
+
+jackInfo:notifier(nocurses) -- notify nocurses in case of new messages
+
+local client = ljack.client_open("example11.lua", jackInfo)
+
+client:activate()
+
+----------------------------------------------------------------------------------------------------
+
+local myPorts = {}
+for i = 1, 4 do
+    myPorts[i] = client:port_register(format("audio_in%d", i), "AUDIO", "IN")
+end
+local otherPorts = client:get_ports(".*", "AUDIO", "OUT")
+if #otherPorts == 0 then
+    print("No AUDIO OUT ports found")
+    os.exit()
+end
+
+local function otherPort(i)
+    return otherPorts[(i - 1) % #otherPorts + 1]
+end
+
+-- setup B swaps the sources of the inputs 2 and 3, i.e. switching between
+-- the setups leaves half of the connections unchanged
+local setups = {
+    A = { { otherPort(1), myPorts[1] }, { otherPort(2), myPorts[2] },
+          { otherPort(3), myPorts[3] }, { otherPort(4), myPorts[4] } },
+    B = { { otherPort(1), myPorts[1] }, { otherPort(3), myPorts[2] },
+          { otherPort(2), myPorts[3] }, { otherPort(4), myPorts[4] } },
+}
+
+local function apply(name)
+    local rslt = client:apply_connections(setups[name])
+    print(format("setup %s: connected %d, disconnected %d, unchanged %d",
+                 name, rslt.connected, rslt.disconnected, rslt.unchanged))
+    for _, f in ipairs(rslt.failed) do
+        print(format("failed to %s %s -> %s", f[3], f[1], f[2]))
+    end
+end
+
+local function printConnections()
+    for _, p in ipairs(myPorts) do
+        local cons = client:graph_get_connections(p)
+        print(format("%-30s <- %s", p:name(), table.concat(cons, ", ")))
+    end
+end
+
+local function printHelp()
+    printbold("Press key a or b for applying connection setup A or B, "
+            .."p for printing the connections, q for Quit")
+end
+printHelp()
+
+----------------------------------------------------------------------------------------------------
+
+while true do
+    local c = nocurses.getch() -- returns nil if new messages in jackInfo
+    if c then
+        c = string.char(c)
+        if c == "Q" or c == "q" then
+            printbold("Quit.")
+            break
+        elseif c == "a" or c == "A" then
+            apply("A")
+        elseif c == "b" or c == "B" then
+            apply("B")
+        elseif c == "p" then
+            printConnections()
+        else
+            printHelp()
+        end
+    end
+    repeat
+        local msg, arg1, arg2 = jackInfo:nextmsg(0)
+        if msg == "ConnectionsApplied" then
+            print(format("ConnectionsApplied: %d connected, %d disconnected", arg1, arg2))
+        elseif msg == "PortConnect" then
+            print("PortConnect")
+        end
+    until not msg
+end
+
+----------------------------------------------------------------------------------------------------
@@ -64,8 +64,15 @@
         #define _XOPEN_SOURCE 600 /* must be defined before any other include */
     #endif
     #include <errno.h>
+    #include <time.h>
     #include <sys/time.h>
     #include <pthread.h>
+    #if defined(__APPLE__) && defined(__MACH__)
+        #include <dispatch/dispatch.h>
+        #include <mach/mach_time.h>
+    #else
+        #include <semaphore.h>
+    #endif
 #endif
 #if defined(LJACK_ASYNC_USE_WIN32) || defined(LJACK_ASYNC_USE_WINTHREAD)
     #include <windows.h>
@@ -75,6 +82,7 @@
     #include <stdatomic.h>
 #endif
 #if defined(LJACK_ASYNC_USE_STDTHREAD)
+    #include <time.h>
     #include <sys/time.h>
     #include <threads.h>
 #endif
@@ -94,5 +102,15 @@
 
 /* -------------------------------------------------------------------------------------------- */
 
+#if defined(_MSC_VER)
+    #define LJACK_ASYNC_THREAD_LOCAL __declspec(thread)
+#elif __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+    #define LJACK_ASYNC_THREAD_LOCAL _Thread_local
+#else
+    #define LJACK_ASYNC_THREAD_LOCAL __thread
+#endif
+
+/* -------------------------------------------------------------------------------------------- */
+
 
 #endif /* LJACK_ASYNC_DEFINES_H */
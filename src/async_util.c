@@ -177,3 +177,108 @@ bool ljack_async_mutex_wait_millis(Mutex* mutex, int timeoutMillis)
 
 #endif
 }
+
+
+void ljack_async_semaphore_init(Semaphore* sem)
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    sem->sem = dispatch_semaphore_create(0);
+    if (sem->sem == NULL) { async_util_abort(0, __LINE__); }
+
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    int rc = sem_init(&sem->sem, 0, 0);
+    if (rc != 0) { async_util_abort(errno, __LINE__); }
+
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    sem->sem = CreateSemaphore(NULL,     /* no security */
+                               0,        /* initial count */
+                               LONG_MAX, /* maximum count */
+                               NULL);    /* unnamed */
+    if (sem->sem == NULL) { async_util_abort(GetLastError(), __LINE__); }
+
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    int rc = mtx_init(&sem->mutex, mtx_plain);
+    if (rc != thrd_success) { async_util_abort(rc, __LINE__); }
+
+    rc = cnd_init(&sem->condition);
+    if (rc != thrd_success) { async_util_abort(rc, __LINE__); }
+    
+    sem->count = 0;
+#endif
+}
+
+void ljack_async_semaphore_destruct(Semaphore* sem)
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    dispatch_release(sem->sem);
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    sem_destroy(&sem->sem);
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    CloseHandle(sem->sem);
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    cnd_destroy(&sem->condition);
+    mtx_destroy(&sem->mutex);
+#endif
+}
+
+void ljack_async_semaphore_wait(Semaphore* sem)
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    dispatch_semaphore_wait(sem->sem, DISPATCH_TIME_FOREVER);
+
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    while (sem_wait(&sem->sem) != 0) {
+        if (errno != EINTR) { async_util_abort(errno, __LINE__); }
+    }
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    DWORD rc = WaitForSingleObject(sem->sem, INFINITE);
+    if  (rc != WAIT_OBJECT_0) { async_util_abort(rc, __LINE__); }
+
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    int rc = mtx_lock(&sem->mutex);
+    if (rc != thrd_success)  { async_util_abort(rc, __LINE__); }
+    while (sem->count == 0) {
+        rc = cnd_wait(&sem->condition, &sem->mutex);
+        if (rc != thrd_success) { async_util_abort(rc, __LINE__); }
+    }
+    sem->count -= 1;
+    rc = mtx_unlock(&sem->mutex);
+    if (rc != thrd_success)  { async_util_abort(rc, __LINE__); }
+#endif
+}
+
+/* -------------------------------------------------------------------------------------------- */
+
+uint64_t ljack_async_clock_nanos(void)
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t c = counter.QuadPart;
+    uint64_t f = frequency.QuadPart;
+    return (c / f) * 1000000000 + (c % f) * 1000000000 / f;
+
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* -------------------------------------------------------------------------------------------- */
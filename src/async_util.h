@@ -46,6 +46,19 @@ static inline void* atomic_get_ptr(AtomicPtr* ptr)
 #endif
 }
 
+static inline void* atomic_set_ptr(AtomicPtr* ptr, void* newPtr)
+{
+#if defined(LJACK_ASYNC_USE_WIN32)
+    return InterlockedExchangePointer(ptr, newPtr);
+#elif defined(LJACK_ASYNC_USE_STDATOMIC)
+    return (void*)atomic_exchange(ptr, (intptr_t)newPtr);
+#elif defined(LJACK_ASYNC_USE_GNU)
+    void* rslt = __sync_lock_test_and_set(ptr, newPtr);
+    __sync_synchronize();
+    return rslt;
+#endif
+}
+
 /* -------------------------------------------------------------------------------------------- */
 
 static inline int atomic_inc(AtomicCounter* value)
@@ -340,5 +353,77 @@ static inline void async_mutex_notify(Mutex* mutex)
 
 /* -------------------------------------------------------------------------------------------- */
 
+typedef struct
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    dispatch_semaphore_t  sem;
+
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    sem_t                 sem;
+
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    HANDLE                sem;
+
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    mtx_t                 mutex;
+    cnd_t                 condition;
+    int                   count;
+#endif
+} Semaphore;
+
+/* -------------------------------------------------------------------------------------------- */
+
+#define async_semaphore_init ljack_async_semaphore_init
+void async_semaphore_init(Semaphore* sem);
+
+/* -------------------------------------------------------------------------------------------- */
+
+#define async_semaphore_destruct ljack_async_semaphore_destruct
+void async_semaphore_destruct(Semaphore* sem);
+
+/* -------------------------------------------------------------------------------------------- */
+
+/**
+ * May be called from the realtime thread.
+ */
+static inline void async_semaphore_post(Semaphore* sem)
+{
+#if defined(LJACK_ASYNC_USE_PTHREAD) && defined(__APPLE__) && defined(__MACH__)
+    dispatch_semaphore_signal(sem->sem);
+
+#elif defined(LJACK_ASYNC_USE_PTHREAD)
+    int rc = sem_post(&sem->sem);
+    if (rc != 0) { async_util_abort(errno, __LINE__); }
+
+#elif defined(LJACK_ASYNC_USE_WINTHREAD)
+    if (!ReleaseSemaphore(sem->sem, 1, NULL)) {
+        async_util_abort(GetLastError(), __LINE__);
+    }
+#elif defined(LJACK_ASYNC_USE_STDTHREAD)
+    int rc = mtx_lock(&sem->mutex);
+    if (rc != thrd_success)  { async_util_abort(rc, __LINE__); }
+    sem->count += 1;
+    rc = cnd_signal(&sem->condition);
+    if (rc != thrd_success)  { async_util_abort(rc, __LINE__); }
+    rc = mtx_unlock(&sem->mutex);
+    if (rc != thrd_success)  { async_util_abort(rc, __LINE__); }
+#endif
+}
+
+/* -------------------------------------------------------------------------------------------- */
+
+#define async_semaphore_wait ljack_async_semaphore_wait
+void async_semaphore_wait(Semaphore* sem);
+
+/* -------------------------------------------------------------------------------------------- */
+
+/**
+ * Monotonic clock in nanoseconds, may be called from the realtime thread.
+ */
+#define async_clock_nanos ljack_async_clock_nanos
+uint64_t async_clock_nanos(void);
+
+/* -------------------------------------------------------------------------------------------- */
+
 #endif /* LJACK_ASYNC_UTIL_H */
 
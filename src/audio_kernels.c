@@ -0,0 +1,215 @@
+/* async_defines.h must be included first */
+#include "async_defines.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define LJACK_AUDIO_KERNELS_X86 1
+    #include <immintrin.h>
+#else
+    #define LJACK_AUDIO_KERNELS_X86 0
+#endif
+
+#include "util.h"
+#include "audio_kernels.h"
+
+/* ============================================================================================ */
+
+static void scalar_clear(float* dst, uint32_t nframes)
+{
+    memset(dst, 0, nframes * sizeof(float));
+}
+
+static void scalar_copy(float* dst, const float* src, uint32_t nframes)
+{
+    memcpy(dst, src, nframes * sizeof(float));
+}
+
+static void scalar_gain(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    for (uint32_t i = 0; i < nframes; ++i) {
+        dst[i] = gain * src[i];
+    }
+}
+
+static void scalar_mixAdd(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    for (uint32_t i = 0; i < nframes; ++i) {
+        dst[i] += gain * src[i];
+    }
+}
+
+static void scalar_pan(float* left, float* right, const float* src,
+                       float leftGain, float rightGain, uint32_t nframes)
+{
+    for (uint32_t i = 0; i < nframes; ++i) {
+        float s = src[i];
+        left[i]  = leftGain  * s;
+        right[i] = rightGain * s;
+    }
+}
+
+/* ============================================================================================ */
+
+#if LJACK_AUDIO_KERNELS_X86
+
+/* The vector loops process all complete vectors, the remaining frames are
+ * handled by the scalar functions. Copy and clear are left to memcpy and memset
+ * which are already vectorized by the C library. */
+
+__attribute__((target("sse2")))
+static void sse2_gain(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m128   g = _mm_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 4 <= nframes; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(g, _mm_loadu_ps(src + i)));
+    }
+    scalar_gain(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_mixAdd(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m128   g = _mm_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 4 <= nframes; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(g, _mm_loadu_ps(src + i))));
+    }
+    scalar_mixAdd(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_pan(float* left, float* right, const float* src,
+                     float leftGain, float rightGain, uint32_t nframes)
+{
+    __m128   gl = _mm_set1_ps(leftGain);
+    __m128   gr = _mm_set1_ps(rightGain);
+    uint32_t i  = 0;
+    for (; i + 4 <= nframes; i += 4) {
+        __m128 s = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(left  + i, _mm_mul_ps(gl, s));
+        _mm_storeu_ps(right + i, _mm_mul_ps(gr, s));
+    }
+    scalar_pan(left + i, right + i, src + i, leftGain, rightGain, nframes - i);
+}
+
+/* -------------------------------------------------------------------------------------------- */
+
+__attribute__((target("avx2")))
+static void avx2_gain(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m256   g = _mm256_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 8 <= nframes; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+    }
+    scalar_gain(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_mixAdd(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m256   g = _mm256_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 8 <= nframes; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(g, _mm256_loadu_ps(src + i))));
+    }
+    scalar_mixAdd(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_pan(float* left, float* right, const float* src,
+                     float leftGain, float rightGain, uint32_t nframes)
+{
+    __m256   gl = _mm256_set1_ps(leftGain);
+    __m256   gr = _mm256_set1_ps(rightGain);
+    uint32_t i  = 0;
+    for (; i + 8 <= nframes; i += 8) {
+        __m256 s = _mm256_loadu_ps(src + i);
+        _mm256_storeu_ps(left  + i, _mm256_mul_ps(gl, s));
+        _mm256_storeu_ps(right + i, _mm256_mul_ps(gr, s));
+    }
+    scalar_pan(left + i, right + i, src + i, leftGain, rightGain, nframes - i);
+}
+
+/* -------------------------------------------------------------------------------------------- */
+
+__attribute__((target("avx512f")))
+static void avx512_gain(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m512   g = _mm512_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 16 <= nframes; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(g, _mm512_loadu_ps(src + i)));
+    }
+    scalar_gain(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_mixAdd(float* dst, const float* src, float gain, uint32_t nframes)
+{
+    __m512   g = _mm512_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i + 16 <= nframes; i += 16) {
+        __m512 d = _mm512_loadu_ps(dst + i);
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(d, _mm512_mul_ps(g, _mm512_loadu_ps(src + i))));
+    }
+    scalar_mixAdd(dst + i, src + i, gain, nframes - i);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_pan(float* left, float* right, const float* src,
+                       float leftGain, float rightGain, uint32_t nframes)
+{
+    __m512   gl = _mm512_set1_ps(leftGain);
+    __m512   gr = _mm512_set1_ps(rightGain);
+    uint32_t i  = 0;
+    for (; i + 16 <= nframes; i += 16) {
+        __m512 s = _mm512_loadu_ps(src + i);
+        _mm512_storeu_ps(left  + i, _mm512_mul_ps(gl, s));
+        _mm512_storeu_ps(right + i, _mm512_mul_ps(gr, s));
+    }
+    scalar_pan(left + i, right + i, src + i, leftGain, rightGain, nframes - i);
+}
+
+#endif /* LJACK_AUDIO_KERNELS_X86 */
+
+/* ============================================================================================ */
+
+auproc_audiokernels ljack_audio_kernels =
+{
+    "scalar",
+    scalar_clear,
+    scalar_copy,
+    scalar_gain,
+    scalar_mixAdd,
+    scalar_pan
+};
+
+void ljack_audio_kernels_init(void)
+{
+#if LJACK_AUDIO_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        ljack_audio_kernels.name   = "avx512f";
+        ljack_audio_kernels.gain   = avx512_gain;
+        ljack_audio_kernels.mixAdd = avx512_mixAdd;
+        ljack_audio_kernels.pan    = avx512_pan;
+    }
+    else if (__builtin_cpu_supports("avx2")) {
+        ljack_audio_kernels.name   = "avx2";
+        ljack_audio_kernels.gain   = avx2_gain;
+        ljack_audio_kernels.mixAdd = avx2_mixAdd;
+        ljack_audio_kernels.pan    = avx2_pan;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        ljack_audio_kernels.name   = "sse2";
+        ljack_audio_kernels.gain   = sse2_gain;
+        ljack_audio_kernels.mixAdd = sse2_mixAdd;
+        ljack_audio_kernels.pan    = sse2_pan;
+    }
+#endif
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,19 @@
+#ifndef LJACK_AUDIO_KERNELS_H
+#define LJACK_AUDIO_KERNELS_H
+
+#include "util.h"
+#include "auproc_capi.h"
+
+/* ============================================================================================ */
+
+/**
+ * Audio kernels for the Auproc C API. The functions are selected by CPU features
+ * in ljack_audio_kernels_init() which is called when the module is loaded.
+ */
+extern auproc_audiokernels ljack_audio_kernels;
+
+void ljack_audio_kernels_init(void);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_AUDIO_KERNELS_H */
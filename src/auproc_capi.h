@@ -4,8 +4,8 @@
 #define AUPROC_CAPI_ID_STRING     "_capi_auproc"
 
 #define AUPROC_CAPI_VERSION_MAJOR  0
-#define AUPROC_CAPI_VERSION_MINOR  0
-#define AUPROC_CAPI_VERSION_PATCH  1
+#define AUPROC_CAPI_VERSION_MINOR  2
+#define AUPROC_CAPI_VERSION_PATCH  0
 
 #ifndef AUPROC_CAPI_IMPLEMENT_SET_CAPI
 #  define AUPROC_CAPI_IMPLEMENT_SET_CAPI 0
@@ -30,6 +30,7 @@ struct auproc_audiometh;
 struct auproc_con_reg;
 struct auproc_con_reg_err;
 struct auproc_midi_event;
+struct auproc_audiokernels;
 
 #else /* __cplusplus */
 
@@ -44,11 +45,13 @@ typedef struct auproc_audiometh    auproc_audiometh;
 typedef struct auproc_con_reg      auproc_con_reg;
 typedef struct auproc_con_reg_err  auproc_con_reg_err;
 typedef struct auproc_midi_event   auproc_midi_event;
+typedef struct auproc_audiokernels auproc_audiokernels;
 
 typedef enum   auproc_reg_err_type  auproc_reg_err_type;
 typedef enum   auproc_direction auproc_direction;
 typedef enum   auproc_obj_type  auproc_obj_type;
 typedef enum   auproc_con_type  auproc_con_type;
+typedef enum   auproc_proc_flag auproc_proc_flag;
 
 #endif /* ! __cplusplus */
 
@@ -72,6 +75,36 @@ enum auproc_obj_type
     AUPROC_TCONNECTOR  = 2
 };
 
+/**
+ * Processor flags (since version 0.2), see setProcessorFlags.
+ */
+enum auproc_proc_flag
+{
+    AUPROC_PROC_NO_FLAGS = 0,
+
+    /**
+     * The processor's outputs are silent if all its inputs are silent, i.e. the
+     * processor has no internal state that produces output from previous input
+     * (e.g. a reverb tail) and does not generate output on its own. The engine 
+     * does not call the processCallback in process cycles where all inputs are 
+     * silent and marks all outputs as silent instead. Processors without input 
+     * connectors are always invoked.
+     */
+    AUPROC_PROC_SILENT_IF_INPUTS_SILENT = 1,
+    
+    /**
+     * The processCallback is invoked for consecutive sub-blocks of the process cycle
+     * which are split at the times of the MIDI events of the processor's MIDI input 
+     * connectors. The argument nframes of the processCallback is the length of the
+     * sub-block, its offset within the process cycle is obtained by getSubBlockOffset.
+     * The processor must handle the audio buffer range [offset, offset + nframes) 
+     * and the MIDI events with times in this range. Sub-blocks are not shorter than
+     * a minimum size that is configured for the engine, i.e. MIDI events may be 
+     * located anywhere within a sub-block.
+     */
+    AUPROC_PROC_SUB_BLOCKS = 2
+};
+
 enum auproc_reg_err_type 
 {
     AUPROC_CAPI_REG_NO_ERROR = 0,
@@ -131,6 +164,21 @@ struct auproc_audiometh
      * pointer is only valid until the call to processCallback returns.
      */
     float* (*getAudioBuffer)(auproc_connector* connector, uint32_t nframes);
+
+    /**
+     * Returns a value not equal to 0 if the buffer of the connector is silent in the
+     * current process cycle, i.e. it contains only zeros (since version 0.2).
+     * This function should only be called within the processCallback.
+     */
+    int (*isSilent)(auproc_connector* connector, uint32_t nframes);
+
+    /**
+     * Fills the buffer of an output connector with zeros and marks it as silent for 
+     * the current process cycle (since version 0.2). This is cheaper than clearing the
+     * buffer, if it was already silent in the previous process cycle.
+     * This function should only be called within the processCallback.
+     */
+    void (*setSilent)(auproc_connector* connector, uint32_t nframes);
 };
 
 
@@ -186,6 +234,76 @@ struct auproc_midimeth
     unsigned char* (*reserveMidiEvent)(auproc_midibuf*  midibuf,
                                        uint32_t         time,
                                        size_t           data_size);
+
+    /**
+     * Gives direct read access to all events of the buffer (since version 0.2).
+     * Sets *count to the number of events and returns a pointer to the first event.
+     * Returns NULL if the buffer does not store its events as array, e.g. for 
+     * JACK ports. In this case use getMidiEvents. The returned pointer is only 
+     * valid until the call to processCallback returns.
+     */
+    const auproc_midi_event* (*getMidiEventArray)(auproc_midibuf* midibuf,
+                                                  uint32_t*       count);
+
+    /**
+     * Copies up to maxCount events starting at firstIndex into the array events
+     * (since version 0.2). Returns the number of copied events.
+     */
+    uint32_t (*getMidiEvents)(auproc_midi_event* events,
+                              auproc_midibuf*    midibuf,
+                              uint32_t           firstIndex,
+                              uint32_t           maxCount);
+
+    /**
+     * Writes count events into the buffer (since version 0.2). The caller is 
+     * responsible for placing the events in order, sorted by their sample offsets,
+     * also with respect to events that are already in the buffer.
+     * Returns the number of written events, i.e. less than count if there is
+     * not enough space.
+     */
+    uint32_t (*writeMidiEvents)(auproc_midibuf*          midibuf,
+                                const auproc_midi_event* events,
+                                uint32_t                 count);
+};
+
+/**
+ * Optimized functions for processing audio buffers (since version 0.2).
+ * The implementation is selected according to the CPU features when the
+ * engine is loaded, e.g. SSE2, AVX2 or AVX-512. All functions may be called
+ * from the processCallback, buffers need not to be aligned.
+ */
+struct auproc_audiokernels
+{
+    /**
+     * Name of the selected implementation, e.g. "scalar", "sse2", "avx2" or "avx512f".
+     */
+    const char* name;
+
+    /**
+     * dst[i] = 0
+     */
+    void (*clear)(float* dst, uint32_t nframes);
+
+    /**
+     * dst[i] = src[i], dst and src must not overlap.
+     */
+    void (*copy)(float* dst, const float* src, uint32_t nframes);
+
+    /**
+     * dst[i] = gain * src[i], dst may be equal to src.
+     */
+    void (*gain)(float* dst, const float* src, float gain, uint32_t nframes);
+
+    /**
+     * dst[i] += gain * src[i]
+     */
+    void (*mixAdd)(float* dst, const float* src, float gain, uint32_t nframes);
+
+    /**
+     * left[i] = leftGain * src[i], right[i] = rightGain * src[i]
+     */
+    void (*pan)(float* left, float* right, const float* src, 
+                float leftGain, float rightGain, uint32_t nframes);
 };
 
 /**
@@ -350,8 +468,9 @@ struct auproc_capi
      * calling registerProcessor. If this process buffer is registered
      * with AUPROC_OUT, the method getPossibleDirections will return 
      * AUPROC_IN afterwards, since a process buffer object
-     * may only be used as input connector if it used as output
-     * connector by another processor.
+     * may only be used as output connector by one processor.
+     * A process buffer without writer may nevertheless be registered
+     * with AUPROC_IN, see conRegList in registerProcessor.
      */
     auproc_direction (*getPossibleDirections)(lua_State* L, int index);
 
@@ -385,7 +504,8 @@ struct auproc_capi
      *                       on the stack at firstConnectorIndex. The members conDirection
      *                       and conType must match the corresponding Lua connector objects given 
      *                       on the Lua stack. The member conDirection must be AUPROC_IN
-     *                       or AUPROC_OUT.
+     *                       or AUPROC_OUT. A process buffer may be registered as AUPROC_IN
+     *                       before its writer is registered, it is silent until then.
      * regError            - this method returns NULL on failure and gives additional error 
      *                       information in regError if regError != NULL. Member conIndex
      *                       contains the index offset of the connector, i.e. if there is an error with
@@ -473,6 +593,152 @@ struct auproc_capi
     void (*logInfo)(auproc_engine* engine,
                     const char* fmt, ...);
     
+    /**
+     * Begins a transaction (since version 0.1). Until the matching call to 
+     * commitTransaction, the changes of registerProcessor, unregisterProcessor,
+     * activateProcessor and deactivateProcessor are collected and become visible 
+     * to realtime processing all at once within the same process cycle. 
+     * Transactions may be nested, the changes become visible when the outermost 
+     * transaction is committed.
+     *
+     * Processors that are unregistered within a transaction are no longer invoked
+     * after unregisterProcessor returns, i.e. the processor data may be freed 
+     * by the caller.
+     * 
+     * Raises a Lua error if engine was closed.
+     */
+    void (*beginTransaction)(lua_State* L, auproc_engine* engine);
+    
+    /**
+     * Commits the transaction that was begun by beginTransaction (since version 0.1).
+     * Raises a Lua error if there is no transaction.
+     */
+    void (*commitTransaction)(lua_State* L, auproc_engine* engine);
+
+    /**
+     * Optimized audio functions (since version 0.2), see struct auproc_audiokernels.
+     */
+    const auproc_audiokernels* audioKernels;
+
+    /**
+     * Sets processor flags (since version 0.2), see enum auproc_proc_flag.
+     * flags is a combination of auproc_proc_flag values.
+     * Raises a Lua error if engine was closed.
+     */
+    void (*setProcessorFlags)(lua_State* L,
+                              auproc_engine* engine,
+                              auproc_processor* processor,
+                              int flags);
+
+    /**
+     * Returns the offset of the current sub-block within the process cycle for 
+     * processors with flag AUPROC_PROC_SUB_BLOCKS (since version 0.2). Returns 0
+     * for other processors.
+     * This function should only be called within the processCallback.
+     */
+    uint32_t (*getSubBlockOffset)(auproc_processor* processor);
+
+    /**
+     * Sets an internal block size for the processor (since version 0.2). Must be
+     * called after registerProcessor and before the processor is activated. 
+     * Only processors with AUDIO connectors are supported.
+     *
+     * The engine buffers all connectors in FIFOs of blockSize frames and invokes 
+     * the processCallback with nframes == blockSize whenever the FIFOs are full, 
+     * i.e. the processor's outputs are delayed by blockSize frames, see 
+     * getProcessorLatency. The bufferSizeCallback is invoked with blockSize and is 
+     * not invoked for changes of the engine's buffer size.
+     *
+     * conRegList - the list that was given to registerProcessor. The members connector
+     *              and audioMethods are replaced by the FIFOs.
+     *
+     * Raises a Lua error if the block size cannot be set.
+     */
+    void (*setProcessorBlockSize)(lua_State* L,
+                                  auproc_engine* engine,
+                                  auproc_processor* processor,
+                                  uint32_t blockSize,
+                                  auproc_con_reg* conRegList);
+
+    /**
+     * Returns the latency in frames of the processor, i.e. the latency declared by
+     * setProcessorLatency plus the latency that is added by the engine for internal 
+     * block size or asynchronous invocation (since version 0.2).
+     */
+    uint32_t (*getProcessorLatency)(auproc_engine* engine,
+                                    auproc_processor* processor);
+
+    /**
+     * Lets the processor be invoked asynchronously in a non realtime thread of its
+     * own (since version 0.2). Must be called after registerProcessor and before the
+     * processor is activated. Only processors with AUDIO connectors are supported.
+     *
+     * The engine copies the inputs of each process cycle into preallocated buffers 
+     * and outputs the results delay process cycles later, i.e. the processor's outputs
+     * are delayed by delay * buffer size frames, see getProcessorLatency. The realtime
+     * processing never waits for the processor: if the results are not ready in time 
+     * the outputs are silent for this process cycle, see getProcessorMissedCycles.
+     *
+     * delay      - number of process cycles, 1 or 2.
+     * conRegList - the list that was given to registerProcessor. The members connector
+     *              and audioMethods are replaced by the preallocated buffers.
+     *
+     * Raises a Lua error if asynchronous invocation cannot be set.
+     */
+    void (*setProcessorAsync)(lua_State* L,
+                              auproc_engine* engine,
+                              auproc_processor* processor,
+                              int delay,
+                              auproc_con_reg* conRegList);
+
+    /**
+     * Returns the number of process cycles for which an asynchronously invoked 
+     * processor did not deliver its results in time (since version 0.2).
+     */
+    int (*getProcessorMissedCycles)(auproc_engine* engine,
+                                    auproc_processor* processor);
+
+    /**
+     * Declares the latency in frames of the processor's algorithm, i.e. the delay
+     * between its inputs and outputs (since version 0.2). The engine adds this 
+     * latency to the latency of the processor chains and publishes the resulting
+     * latency ranges on its own ports to other JACK clients. May be called at any
+     * time, e.g. whenever the processor's latency changes.
+     */
+    void (*setProcessorLatency)(lua_State* L,
+                                auproc_engine* engine,
+                                auproc_processor* processor,
+                                uint32_t latency);
+
+    /**
+     * Merges the events of several MIDI buffers in a single pass into one output 
+     * MIDI buffer (since version 0.2). The events are written in time order, events
+     * with equal time are written in the order of the input list. The output buffer
+     * is cleared first and must not be one of the input buffers. 
+     * May be called from the processCallback.
+     *
+     * outBuf, outMethods - output buffer, obtained by getMidiBuffer of an output 
+     *                      connector.
+     * inBufs, inMethods  - lists of inCount input buffers and their midiMethods.
+     * inCount            - number of input buffers, at most 256.
+     *
+     * Returns the number of events that could not be written because the output
+     * buffer is full or -1 if inCount is invalid.
+     */
+    int (*mergeMidiEvents)(auproc_midibuf*               outBuf, 
+                           const auproc_midimeth*        outMethods,
+                           auproc_midibuf* const*        inBufs,
+                           const auproc_midimeth* const* inMethods,
+                           int                           inCount);
+
+    /**
+     * Ends the transaction that was begun by beginTransaction without raising
+     * a Lua error (since version 0.2), e.g. if the changes within the transaction
+     * were interrupted by a Lua error that was caught by lua_pcall. The changes
+     * that were made so far are not undone: they become visible to realtime 
+     * processing like by commitTransaction. Does nothing if there is no transaction.
+     */
+    void (*abortTransaction)(lua_State* L, auproc_engine* engine);
 };
 
 
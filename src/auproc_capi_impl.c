@@ -9,6 +9,10 @@
 #include "port.h"
 #include "procbuf.h"
 #include "client_intern.h"
+#include "client_events.h"
+#include "client_async.h"
+#include "midi_merge.h"
+#include "audio_kernels.h"
 
 #include "main.h"
 
@@ -57,7 +61,59 @@ static jack_default_audio_sample_t* port_getAudioBuffer(auproc_connector* connec
 static jack_default_audio_sample_t* procbuf_getAudioBuffer(auproc_connector* connector, jack_nframes_t nframes)
 {
     ProcBufUserData* udata = (ProcBufUserData*) connector;
-    return (jack_default_audio_sample_t*) udata->ringBuffer->buf;
+    return (jack_default_audio_sample_t*) udata->buffer;
+}
+
+static int port_isSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    return ljack_client_intern_port_is_silent((PortUserData*) connector, nframes);
+}
+
+static int procbuf_isSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    return ljack_client_intern_procbuf_is_silent((ProcBufUserData*) connector, nframes);
+}
+
+static void port_setSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    ljack_client_intern_port_set_silent((PortUserData*) connector, nframes);
+}
+
+static void procbuf_setSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    ljack_client_intern_procbuf_set_silent((ProcBufUserData*) connector, nframes);
+}
+
+/* ============================================================================================ */
+
+static jack_default_audio_sample_t* block_getAudioBuffer(auproc_connector* connector, jack_nframes_t nframes)
+{
+    ConnectorInfo* info = (ConnectorInfo*) connector;
+    return info->blockBuffer;
+}
+
+static int block_isSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    return 0;
+}
+
+static void block_setSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    ConnectorInfo* info = (ConnectorInfo*) connector;
+    memset(info->blockBuffer, 0, nframes * sizeof(jack_default_audio_sample_t));
+}
+
+/* ============================================================================================ */
+
+static jack_default_audio_sample_t* async_getAudioBuffer(auproc_connector* connector, jack_nframes_t nframes)
+{
+    return ljack_client_async_get_audio_buffer((LjackAsyncConnector*) connector);
+}
+
+static void async_setSilent(auproc_connector* connector, jack_nframes_t nframes)
+{
+    float* b = ljack_client_async_get_audio_buffer((LjackAsyncConnector*) connector);
+    memset(b, 0, nframes * sizeof(jack_default_audio_sample_t));
 }
 
 /* ============================================================================================ */
@@ -68,6 +124,36 @@ static auproc_midibuf* port_getMidiBuffer(auproc_connector* connector, jack_nfra
     return (auproc_midibuf*) jack_port_get_buffer(udata->port, nframes);
 }
 
+static const auproc_midi_event* port_getMidiEventArray(void* portBuffer, uint32_t* count)
+{
+    /* the event layout of JACK's MIDI buffer is not part of the JACK API */
+    *count = 0;
+    return NULL;
+}
+
+static uint32_t port_getMidiEvents(jack_midi_event_t* events, void* portBuffer,
+                                   uint32_t firstIndex, uint32_t maxCount)
+{
+    uint32_t count = jack_midi_get_event_count(portBuffer);
+    uint32_t n     = 0;
+    for (uint32_t i = firstIndex; i < count && n < maxCount; ++i) {
+        if (jack_midi_event_get(events + n, portBuffer, i) == 0) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+static uint32_t port_writeMidiEvents(void* portBuffer, const jack_midi_event_t* events, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        if (jack_midi_event_write(portBuffer, events[i].time, events[i].buffer, events[i].size) != 0) {
+            return i;
+        }
+    }
+    return count;
+}
+
 static auproc_midibuf* procbuf_getMidiBuffer(auproc_connector* connector, jack_nframes_t nframes)
 {
     ProcBufUserData* udata = (ProcBufUserData*) connector;
@@ -78,6 +164,10 @@ static auproc_midibuf* procbuf_getMidiBuffer(auproc_connector* connector, jack_n
 
 typedef float* (*audiometh_getAudioBuffer)(auproc_connector* connector, uint32_t nframes);
 
+typedef int  (*audiometh_isSilent)(auproc_connector* connector, uint32_t nframes);
+
+typedef void (*audiometh_setSilent)(auproc_connector* connector, uint32_t nframes);
+
 typedef auproc_midibuf* (*midimeth_getMidiBuffer)(auproc_connector* connector, uint32_t nframes);
 
 typedef void (*midimeth_clearBuffer)(auproc_midibuf* midibuf);
@@ -97,18 +187,52 @@ typedef jack_midi_data_t* (*midimeth_reserveMidiEvent)(auproc_midibuf*     midib
                                                        jack_nframes_t          time,
                                                        size_t                  data_size);
 
+typedef const auproc_midi_event* (*midimeth_getMidiEventArray)(auproc_midibuf* midibuf,
+                                                               uint32_t*       count);
+
+typedef uint32_t (*midimeth_getMidiEvents)(auproc_midi_event* events,
+                                           auproc_midibuf*    midibuf,
+                                           uint32_t           firstIndex,
+                                           uint32_t           maxCount);
+
+typedef uint32_t (*midimeth_writeMidiEvents)(auproc_midibuf*          midibuf,
+                                             const auproc_midi_event* events,
+                                             uint32_t                 count);
+
 /* ============================================================================================ */
 
 static const auproc_audiometh portAudioMethods =
 {
-    (audiometh_getAudioBuffer)   port_getAudioBuffer
+    (audiometh_getAudioBuffer)   port_getAudioBuffer,
+    (audiometh_isSilent)         port_isSilent,
+    (audiometh_setSilent)        port_setSilent
 };
 
 /* ============================================================================================ */
 
 static const auproc_audiometh procBufAudioMethods =
 {
-    (audiometh_getAudioBuffer)   procbuf_getAudioBuffer
+    (audiometh_getAudioBuffer)   procbuf_getAudioBuffer,
+    (audiometh_isSilent)         procbuf_isSilent,
+    (audiometh_setSilent)        procbuf_setSilent
+};
+
+/* ============================================================================================ */
+
+static const auproc_audiometh blockAudioMethods =
+{
+    (audiometh_getAudioBuffer)   block_getAudioBuffer,
+    (audiometh_isSilent)         block_isSilent,
+    (audiometh_setSilent)        block_setSilent
+};
+
+/* ============================================================================================ */
+
+static const auproc_audiometh asyncAudioMethods =
+{
+    (audiometh_getAudioBuffer)   async_getAudioBuffer,
+    (audiometh_isSilent)         block_isSilent,
+    (audiometh_setSilent)        async_setSilent
 };
 
 /* ============================================================================================ */
@@ -118,7 +242,10 @@ static const auproc_midimeth portMidiMethods =
     (midimeth_clearBuffer)       jack_midi_clear_buffer,
     (midimeth_getEventCount)     jack_midi_get_event_count,
     (midimeth_getMidiEvent)      jack_midi_event_get,
-    (midimeth_reserveMidiEvent)  jack_midi_event_reserve
+    (midimeth_reserveMidiEvent)  jack_midi_event_reserve,
+    (midimeth_getMidiEventArray) port_getMidiEventArray,
+    (midimeth_getMidiEvents)     port_getMidiEvents,
+    (midimeth_writeMidiEvents)   port_writeMidiEvents
 };
 
 /* ============================================================================================ */
@@ -129,7 +256,10 @@ static const auproc_midimeth procBufMidiMethods =
     (midimeth_clearBuffer)       ljack_procbuf_clear_midi_events,
     (midimeth_getEventCount)     ljack_procbuf_get_midi_event_count,
     (midimeth_getMidiEvent)      ljack_procbuf_get_midi_event,
-    (midimeth_reserveMidiEvent)  ljack_procbuf_reserve_midi_event
+    (midimeth_reserveMidiEvent)  ljack_procbuf_reserve_midi_event,
+    (midimeth_getMidiEventArray) ljack_procbuf_get_midi_event_array,
+    (midimeth_getMidiEvents)     ljack_procbuf_get_midi_events,
+    (midimeth_writeMidiEvents)   ljack_procbuf_write_midi_events
 };
 
 /* ============================================================================================ */
@@ -244,8 +374,9 @@ static auproc_direction getPossibleDirections(lua_State* L, int index)
         if (portUdata->isOutput && portUdata->procUsageCounter == 0)  rslt |= AUPROC_OUT;
     }
     else if (procBufUdata) {
-        if (procBufUdata->outUsageCounter == 0) rslt = AUPROC_OUT;
-        else                                    rslt = AUPROC_IN;
+        if      (procBufUdata->aliasPort && procBufUdata->aliasPort->isInput) rslt = AUPROC_IN;
+        else if (procBufUdata->outUsageCounter == 0)                          rslt = AUPROC_OUT;
+        else                                                                  rslt = AUPROC_IN;
     }
     return rslt;
 }
@@ -294,8 +425,14 @@ static auproc_reg_err_type checkProcBufReg(ClientUserData*  clientUdata,
     if (udata->clientUserData != clientUdata) {
         return AUPROC_REG_ERR_ENGINE_MISMATCH;
     }
-    if ( (conReg->conDirection == AUPROC_IN  && udata->outUsageCounter == 0)
-      || (conReg->conDirection == AUPROC_OUT && udata->outUsageCounter != 0))
+    if (udata->aliasPort && udata->aliasPort->isInput) {
+        /* data comes from the input port, no processor may write it */
+        if (conReg->conDirection == AUPROC_OUT) {
+            return AUPROC_REG_ERR_WRONG_DIRECTION;
+        }
+    }
+    else if ( (conReg->conDirection == AUPROC_OUT && udata->outUsageCounter != 0 && udata->segmentCount == 0)
+           || (conReg->conDirection == AUPROC_OUT && udata->outUsageCounter >= udata->segmentCount && udata->segmentCount > 0))
     {
         return AUPROC_REG_ERR_WRONG_DIRECTION;
     }
@@ -384,28 +521,18 @@ static auproc_processor* registerProcessor(lua_State* L,
     }
     int connectorTableRef = luaL_ref(L, LUA_REGISTRYINDEX);   /* -> */
     
-    LjackProcReg** oldList = clientUdata->procRegList;
-    int            n       = clientUdata->procRegCount;
-    
+    int             n         = clientUdata->procRegCount;
     LjackProcReg*   newReg    = calloc(1, sizeof(LjackProcReg));
-    int             newLength = n + 1;
-    LjackProcReg**  newList   = calloc(newLength + 1, sizeof(LjackProcReg*));
     ConnectorInfo*  conInfos  = calloc(connectorCount, sizeof(ConnectorInfo));
     char*           procName  = malloc(strlen(processorName) + 1);
-    if (!newReg || !newList || !conInfos || !procName) {
+    if (!newReg || !conInfos || !procName || !ljack_client_intern_reserve_proc_regs(clientUdata, n + 1)) {
         if (newReg)   free(newReg);
-        if (newList)  free(newList);
         if (conInfos) free(conInfos);
         if (procName) free(procName);
         luaL_unref(L, LUA_REGISTRYINDEX, connectorTableRef);
         luaL_error(L, "out of memory");
         return NULL;
     }
-    if (oldList) {
-        memcpy(newList, oldList, sizeof(LjackProcReg*) * n);
-    }
-    newList[newLength-1] = newReg;
-    newList[newLength]   = NULL;
     strcpy(procName, processorName);
 
     newReg->processorName          = procName;
@@ -417,34 +544,7 @@ static auproc_processor* registerProcessor(lua_State* L,
     newReg->connectorTableRef      = connectorTableRef;
     newReg->connectorCount         = connectorCount;
     newReg->connectorInfos         = conInfos;
-      
-    for (int i = 0; i < connectorCount; ++i) {
-        PortUserData*    portUdata    = NULL;
-        ProcBufUserData* procBufUdata = NULL;
-        ljack_client_intern_get_connector(L, firstConnectorIndex + i, &portUdata, &procBufUdata);
-        if (portUdata) {
-            conInfos[i].isPort = true;
-            portUdata->procUsageCounter += 1;
-            if (conRegList[i].conDirection == AUPROC_IN) {
-                conInfos[i].isInput  = true;
-            } else {
-                conInfos[i].isOutput = true;
-            }
-            conInfos[i].portUdata = portUdata;
-        } 
-        else if (procBufUdata) {
-            conInfos[i].isProcBuf = true;
-            procBufUdata->procUsageCounter += 1;
-            if (conRegList[i].conDirection == AUPROC_IN) {
-                procBufUdata->inpUsageCounter += 1;
-                conInfos[i].isInput = true;
-            } else {
-                conInfos[i].isOutput = true;
-                procBufUdata->outUsageCounter += 1;
-            }
-            conInfos[i].procBufUdata = procBufUdata;
-        }
-    }
+    newReg->execIndex              = -1;
 
     /* --------------------------------------------------------------------- */
     async_mutex_lock(&clientUdata->processMutex);
@@ -456,30 +556,71 @@ static auproc_processor* registerProcessor(lua_State* L,
         if (rc != 0) {
             async_mutex_unlock(&clientUdata->processMutex);
             free(newReg);
-            free(newList);
             free(conInfos);
             free(procName);
             luaL_unref(L, LUA_REGISTRYINDEX, connectorTableRef);
-            luaL_error(L, "error %d from bufferSizeCallback for processor '%s'", processorName);
+            luaL_error(L, "error %d from bufferSizeCallback for processor '%s'", rc, processorName);
             return NULL;
         }
         newReg->bufferSize = clientUdata->bufferSize;
 
-        clientUdata->procRegList  = newList;
-        clientUdata->procRegCount = newLength;
-        ljack_client_intern_activate_proc_list_LOCKED(clientUdata, newList);
+        for (int i = 0; i < connectorCount; ++i) {
+            PortUserData*    portUdata    = NULL;
+            ProcBufUserData* procBufUdata = NULL;
+            ljack_client_intern_get_connector(L, firstConnectorIndex + i, &portUdata, &procBufUdata);
+            if (portUdata) {
+                conInfos[i].isPort = true;
+                portUdata->procUsageCounter += 1;
+                if (conRegList[i].conDirection == AUPROC_IN) {
+                    conInfos[i].isInput  = true;
+                } else {
+                    conInfos[i].isOutput = true;
+                }
+                conInfos[i].portUdata = portUdata;
+            } 
+            else if (procBufUdata) {
+                conInfos[i].isProcBuf = true;
+                procBufUdata->procUsageCounter += 1;
+                if (conRegList[i].conDirection == AUPROC_IN) {
+                    procBufUdata->inpUsageCounter += 1;
+                    conInfos[i].isInput = true;
+                } else {
+                    conInfos[i].isOutput = true;
+                    procBufUdata->outUsageCounter += 1;
+                    if (procBufUdata->segmentCount > 0) {
+                        /* a free segment exists, see checkProcBufReg */
+                        conInfos[i].midiSegment = ljack_procbuf_acquire_segment(procBufUdata);
+                    }
+                }
+                conInfos[i].procBufUdata = procBufUdata;
+            }
+        }
+        clientUdata->procRegList[n]     = newReg;
+        clientUdata->procRegList[n + 1] = NULL;
+        clientUdata->procRegCount       = n + 1;
     }
     async_mutex_unlock(&clientUdata->processMutex);
     /* --------------------------------------------------------------------- */
     
-    if (oldList) {
-        free(oldList);
+    if (!ljack_client_intern_update_exec_list(clientUdata)) {
+        async_mutex_lock(&clientUdata->processMutex);
+            clientUdata->procRegList[n] = NULL;
+            clientUdata->procRegCount   = n;
+        async_mutex_unlock(&clientUdata->processMutex);
+        ljack_client_intern_release_proc_reg(L, newReg);
+        luaL_error(L, "out of memory");
+        return NULL;
     }
-    
+
     for (int i = 0; i < connectorCount; ++i) {
         PortUserData*    portUdata    = NULL;
         ProcBufUserData* procBufUdata = NULL;
         ljack_client_intern_get_connector(L, firstConnectorIndex + i, &portUdata, &procBufUdata);
+        if (procBufUdata && procBufUdata->aliasPort) {
+            /* process buffer is an alias: hand out the port buffer directly */
+            portUdata    = procBufUdata->aliasPort;
+            procBufUdata = NULL;
+        }
         if (portUdata) {
             conRegList[i].connector = (auproc_connector*)portUdata;
             if (portUdata->isAudio) {
@@ -491,6 +632,11 @@ static auproc_processor* registerProcessor(lua_State* L,
                 conRegList[i].midiMethods  = &portMidiMethods;
             }
         } 
+        else if (newReg->connectorInfos[i].midiSegment) {
+            conRegList[i].connector    = (auproc_connector*)newReg->connectorInfos[i].midiSegment;
+            conRegList[i].audioMethods = NULL;
+            conRegList[i].midiMethods  = &ljack_procbuf_segment_midi_methods;
+        }
         else if (procBufUdata) {
             conRegList[i].connector = (auproc_connector*)procBufUdata;
             if (procBufUdata->isAudio) {
@@ -515,13 +661,13 @@ static void unregisterProcessor(lua_State* L,
     ClientUserData* clientUdata = (ClientUserData*) engine;
     LjackProcReg*   reg         = (LjackProcReg*)   processor;
 
-    int            n       = clientUdata->procRegCount;
-    LjackProcReg** oldList = clientUdata->procRegList;
+    int            n    = clientUdata->procRegCount;
+    LjackProcReg** list = clientUdata->procRegList;
 
     int index = -1;
-    if (oldList) {
+    if (list) {
         for (int i = 0; i < n; ++i) {
-            if (oldList[i] == reg) {
+            if (list[i] == reg) {
                 index = i;
                 break;
             }
@@ -532,43 +678,44 @@ static void unregisterProcessor(lua_State* L,
         return;
     }
 
-    for (int i = 0; i < reg->connectorCount; ++i) {
-        LjackConnectorInfo* info = reg->connectorInfos + i;
-        if (info->isProcBuf && info->isOutput) {
-            if (info->procBufUdata->inpUsageCounter > 0) {
-                luaL_error(L, "process buffer %p data is used by another registered processor", info->procBufUdata);
-                return;
-            }
-        }
-    }
-
-    /* --------------------------------------------------------------------- */
-    
-    LjackProcReg** newList = malloc(sizeof(LjackProcReg*) * (n - 1 + 1));
-    
-    if (!newList) {
-        luaL_error(L, "out of memory");
-        return;
-    }
-    if (index > 0) {
-        memcpy(newList, oldList, sizeof(LjackProcReg*) * index);
-    }
-    if (index + 1 <= n) {
-        memcpy(newList + index, oldList + index + 1, sizeof(LjackProcReg*) * ((n + 1) - (index + 1)));
-    }
+    /* remaining readers of the process buffers written by this processor
+     * are kept going: the next exec list gives them silence */
     
     async_mutex_lock(&clientUdata->processMutex);
     {
-        clientUdata->procRegList  = newList;
+        memmove(list + index, list + index + 1, sizeof(LjackProcReg*) * (n - index));
         clientUdata->procRegCount = n - 1;
-        
-        ljack_client_intern_activate_proc_list_LOCKED(clientUdata, newList);
     }
     async_mutex_unlock(&clientUdata->processMutex);
     
-    ljack_client_intern_release_proc_reg(L, reg);
+    if (clientUdata->transactionDepth == 0) {
+        if (!ljack_client_intern_update_exec_list(clientUdata)) {
+            async_mutex_lock(&clientUdata->processMutex);
+            {
+                memmove(list + index + 1, list + index, sizeof(LjackProcReg*) * (n - index));
+                list[index] = reg;
+                clientUdata->procRegCount = n;
+            }
+            async_mutex_unlock(&clientUdata->processMutex);
+            luaL_error(L, "out of memory");
+            return;
+        }
+        /* the caller may free the processor data after this function returns, therefore
+         * process cycles that are still using the old exec list must have finished. */
+        ljack_client_intern_wait_for_retired_exec_lists(clientUdata);
+    
+        ljack_client_intern_release_proc_reg(L, reg);
+    } 
+    else {
+        /* the processor remains in the active exec list until the transaction is 
+         * committed, but it is no longer invoked by the process thread. */
+        ljack_client_intern_hide_proc_reg(clientUdata, reg);
+        ljack_client_intern_detach_proc_reg(L, reg);
 
-    free(oldList);
+        reg->nextDetached = clientUdata->detachedProcRegs;
+        clientUdata->detachedProcRegs = reg;
+        clientUdata->execListDirty    = true;
+    }
 }
 
 /* ============================================================================================ */
@@ -593,6 +740,7 @@ static void activateProcessor(lua_State* L,
             }
         }
         reg->activated = true;
+        ljack_client_intern_set_exec_activated(clientUdata, reg);
     }
 }
 
@@ -618,7 +766,137 @@ static void deactivateProcessor(lua_State* L,
             }
         }
         reg->activated = false;
+        ljack_client_intern_set_exec_activated(clientUdata, reg);
+    }
+}
+
+/* ============================================================================================ */
+
+static void beginTransaction(lua_State* L, auproc_engine* engine)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    ljack_client_check_is_valid(L, clientUdata);
+    ljack_client_intern_begin_transaction(L, clientUdata);
+}
+
+/* ============================================================================================ */
+
+static void commitTransaction(lua_State* L, auproc_engine* engine)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    ljack_client_intern_commit_transaction(L, clientUdata);
+}
+
+/* ============================================================================================ */
+
+static void abortTransaction(lua_State* L, auproc_engine* engine)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    ljack_client_intern_abort_transaction(clientUdata);
+}
+
+/* ============================================================================================ */
+
+static void setProcessorFlags(lua_State* L,
+                              auproc_engine* engine,
+                              auproc_processor* processor,
+                              int flags)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    LjackProcReg*   reg         = (LjackProcReg*)   processor;
+    ljack_client_check_is_valid(L, clientUdata);
+    
+    reg->silenceInOut = (flags & AUPROC_PROC_SILENT_IF_INPUTS_SILENT) != 0;
+    reg->subBlocks    = (flags & AUPROC_PROC_SUB_BLOCKS) != 0;
+}
+
+/* ============================================================================================ */
+
+static uint32_t getSubBlockOffset(auproc_processor* processor)
+{
+    LjackProcReg* reg = (LjackProcReg*) processor;
+    return reg->subBlockOffset;
+}
+
+/* ============================================================================================ */
+
+static void setProcessorBlockSize(lua_State* L,
+                                  auproc_engine* engine,
+                                  auproc_processor* processor,
+                                  uint32_t blockSize,
+                                  auproc_con_reg* conRegList)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    LjackProcReg*   reg         = (LjackProcReg*)   processor;
+    ljack_client_check_is_valid(L, clientUdata);
+    
+    if (blockSize < 1 || blockSize > LJACK_MAX_BUFFER_SIZE) {
+        luaL_error(L, "block size must be between 1 and %d", LJACK_MAX_BUFFER_SIZE);
+        return;
     }
+    ljack_client_intern_set_block_size(L, clientUdata, reg, blockSize);
+    
+    for (int i = 0; i < reg->connectorCount; ++i) {
+        conRegList[i].connector    = (auproc_connector*)(reg->connectorInfos + i);
+        conRegList[i].audioMethods = &blockAudioMethods;
+    }
+}
+
+/* ============================================================================================ */
+
+static void setProcessorAsync(lua_State* L,
+                              auproc_engine* engine,
+                              auproc_processor* processor,
+                              int delay,
+                              auproc_con_reg* conRegList)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    LjackProcReg*   reg         = (LjackProcReg*)   processor;
+    ljack_client_check_is_valid(L, clientUdata);
+    
+    if (delay < 1 || delay > LJACK_MAX_ASYNC_DELAY) {
+        luaL_error(L, "delay must be between 1 and %d", LJACK_MAX_ASYNC_DELAY);
+        return;
+    }
+    ljack_client_intern_set_async(L, clientUdata, reg, delay);
+    
+    for (int i = 0; i < reg->connectorCount; ++i) {
+        conRegList[i].connector    = (auproc_connector*) ljack_client_async_get_connector(reg->asyncLane, i);
+        conRegList[i].audioMethods = &asyncAudioMethods;
+    }
+}
+
+/* ============================================================================================ */
+
+static uint32_t getProcessorLatency(auproc_engine* engine,
+                                    auproc_processor* processor)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    LjackProcReg*   reg         = (LjackProcReg*)   processor;
+    return ljack_client_intern_get_latency(clientUdata, reg);
+}
+
+/* ============================================================================================ */
+
+static void setProcessorLatency(lua_State* L,
+                                auproc_engine* engine,
+                                auproc_processor* processor,
+                                uint32_t latency)
+{
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    LjackProcReg*   reg         = (LjackProcReg*)   processor;
+    ljack_client_check_is_valid(L, clientUdata);
+
+    ljack_client_intern_set_latency(clientUdata, reg, latency);
+}
+
+/* ============================================================================================ */
+
+static int getProcessorMissedCycles(auproc_engine* engine,
+                                    auproc_processor* processor)
+{
+    LjackProcReg* reg = (LjackProcReg*) processor;
+    return reg->asyncLane ? ljack_client_async_get_missed(reg->asyncLane) : 0;
 }
 
 /* ============================================================================================ */
@@ -634,6 +912,14 @@ static uint32_t getProcessBeginFrameTime(auproc_engine* engine)
 
 static void logError(auproc_engine* engine, const char* fmt, ...)
 {
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    if (clientUdata && clientUdata->events && ljack_client_intern_is_processing_thread()) {
+        va_list args;
+        va_start(args, fmt);
+            ljack_client_events_pushV(clientUdata->events, LJACK_EVENT_LOG_ERROR, 0, fmt, args);
+        va_end(args);
+        return;
+    }
     bool finished;
     do {
         va_list args;
@@ -647,6 +933,14 @@ static void logError(auproc_engine* engine, const char* fmt, ...)
 
 static void logInfo(auproc_engine* engine, const char* fmt, ...)
 {
+    ClientUserData* clientUdata = (ClientUserData*) engine;
+    if (clientUdata && clientUdata->events && ljack_client_intern_is_processing_thread()) {
+        va_list args;
+        va_start(args, fmt);
+            ljack_client_events_pushV(clientUdata->events, LJACK_EVENT_LOG_INFO, 0, fmt, args);
+        va_end(args);
+        return;
+    }
     bool finished;
     do {
         va_list args;
@@ -681,6 +975,18 @@ const auproc_capi auproc_capi_impl =
     "client", /* engine_category_name */    
     logError,
     logInfo,
+    beginTransaction,
+    commitTransaction,
+    &ljack_audio_kernels,
+    setProcessorFlags,
+    getSubBlockOffset,
+    setProcessorBlockSize,
+    getProcessorLatency,
+    setProcessorAsync,
+    getProcessorMissedCycles,
+    setProcessorLatency,
+    ljack_midi_merge,
+    abortTransaction
 };
 
 /* ============================================================================================ */
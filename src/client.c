@@ -11,8 +11,17 @@
 
 #include "client.h"
 #include "client_intern.h"
+#include "client_workers.h"
+#include "client_events.h"
+#include "client_storage.h"
+#include "client_async.h"
+#include "midi_merge.h"
+#include "client_graph.h"
+#include "client_patchbay.h"
+#include "client_coalescer.h"
 #include "port.h"
 #include "procbuf.h"
+#include "matrix_mixer.h"
 
 typedef struct LjackPortUserData     PortUserData;
 typedef struct LjackProcBufUserData  ProcBufUserData;
@@ -45,13 +54,85 @@ static int LjackClient_name_size(lua_State* L)
     return 1;
 }
 
+static int checkIntegerOption(lua_State* L, int optionsArg, const char* name, 
+                              int minValue, int maxValue)
+{
+    if (!lua_isinteger(L, -1)) {
+        return luaL_argerror(L, optionsArg, lua_pushfstring(L, "option '%s': integer expected", name));
+    }
+    lua_Integer v = lua_tointeger(L, -1);
+    if (v < minValue || v > maxValue) {
+        return luaL_argerror(L, optionsArg, lua_pushfstring(L, "option '%s': value must be between %d and %d", 
+                                                               name, minValue, maxValue));
+    }
+    return (int)v;
+}
+
+static bool checkBooleanOption(lua_State* L, int optionsArg, const char* name)
+{
+    if (!lua_isboolean(L, -1)) {
+        return luaL_argerror(L, optionsArg, lua_pushfstring(L, "option '%s': boolean expected", name));
+    }
+    return lua_toboolean(L, -1);
+}
+
+static void parseClientOptions(lua_State* L, int optionsArg, int* workerThreads, int* maxBufferSize,
+                               bool* shareProcBufs, int* minSubBlockSize, 
+                               int* coalescingWindow, int* maxStatusRate, bool* compactStatus)
+{
+    lua_pushnil(L);                                         /* -> nil */
+    while (lua_next(L, optionsArg)) {                       /* -> key, value */
+        if (lua_type(L, -2) != LUA_TSTRING) {
+            luaL_argerror(L, optionsArg, "option names must be strings");
+            return;
+        }
+        const char* name = lua_tostring(L, -2);
+        if (strcmp(name, "worker_threads") == 0) {
+            *workerThreads = checkIntegerOption(L, optionsArg, name, 0, LJACK_MAX_WORKER_THREADS);
+        }
+        else if (strcmp(name, "max_buffer_size") == 0) {
+            *maxBufferSize = checkIntegerOption(L, optionsArg, name, 0, LJACK_MAX_BUFFER_SIZE);
+        }
+        else if (strcmp(name, "share_process_buffers") == 0) {
+            *shareProcBufs = checkBooleanOption(L, optionsArg, name);
+        }
+        else if (strcmp(name, "min_sub_block_size") == 0) {
+            *minSubBlockSize = checkIntegerOption(L, optionsArg, name, 1, LJACK_MAX_BUFFER_SIZE);
+        }
+        else if (strcmp(name, "status_coalescing") == 0) {
+            *coalescingWindow = checkIntegerOption(L, optionsArg, name, 0, LJACK_MAX_COALESCING_WINDOW);
+        }
+        else if (strcmp(name, "max_status_rate") == 0) {
+            *maxStatusRate = checkIntegerOption(L, optionsArg, name, 0, LJACK_MAX_STATUS_RATE);
+        }
+        else if (strcmp(name, "compact_status") == 0) {
+            *compactStatus = checkBooleanOption(L, optionsArg, name);
+        }
+        else {
+            luaL_argerror(L, optionsArg, lua_pushfstring(L, "unknown option '%s'", name));
+            return;
+        }
+        lua_pop(L, 1);                                      /* -> key */
+    }
+}
+
 static int LjackClient_open(lua_State* L)
 {
     int arg = 1;
     const char* clientName = luaL_checkstring(L, arg++);
     const receiver_capi* receiver_capi = NULL;
     receiver_object*     receiver      = NULL;
-    if (!lua_isnoneornil(L, arg)) {
+    int                  workerThreads = 0;
+    int                  maxBufferSize = 0;
+    bool                 shareProcBufs = false;
+    int                  minSubBlockSize = LJACK_DEFAULT_MIN_SUB_BLOCK_SIZE;
+    int                  coalescingWindow = 0;
+    int                  maxStatusRate    = 0;
+    bool                 compactStatus    = false;
+    if (lua_isnil(L, arg) && lua_istable(L, arg + 1)) {
+        ++arg;
+    }
+    else if (!lua_isnoneornil(L, arg) && !lua_istable(L, arg)) {
         int versErr = 0;
         receiver_capi = receiver_get_capi(L, arg, &versErr);
         if (receiver_capi) {
@@ -63,8 +144,14 @@ static int LjackClient_open(lua_State* L)
             }
         }
     }
-    if (!receiver && !lua_isnoneornil(L, arg)) {
-        return luaL_argerror(L, arg, "expected receiver object");
+    if (lua_istable(L, arg)) {
+        parseClientOptions(L, arg, &workerThreads, &maxBufferSize, &shareProcBufs, &minSubBlockSize,
+                           &coalescingWindow, &maxStatusRate, &compactStatus);
+        ++arg;
+    }
+    if (!lua_isnoneornil(L, arg)) {
+        return luaL_argerror(L, arg, receiver ? "expected options table" 
+                                              : "expected receiver object or options table");
     }
     
     ClientUserData* udata = lua_newuserdata(L, sizeof(ClientUserData));
@@ -74,8 +161,11 @@ static int LjackClient_open(lua_State* L)
     lua_setmetatable(L, -2);                                /* -> udata */
 
     udata->className      = LJACK_CLIENT_CLASS_NAME;
+    udata->shareProcBufs  = shareProcBufs;
+    udata->minSubBlockSize = minSubBlockSize;
     udata->weakTableRef   = LUA_REFNIL;
     udata->strongTableRef = LUA_REFNIL;
+    udata->processCycle   = 2; /* silentCycle 0 of new connectors never matches the previous cycle */
 
     lua_newtable(L);                                        /* -> udata, weakTable */
     lua_newtable(L);                                        /* -> udata, weakTable, meta */
@@ -92,11 +182,13 @@ static int LjackClient_open(lua_State* L)
     if (receiver) {
         udata->receiver_capi   = receiver_capi;
         udata->receiver_writer = receiver_capi->newWriter(1024, 2);
-        if (!udata->receiver_writer) {
+        udata->patchbayWriter  = receiver_capi->newWriter(1024, 2);
+        if (!udata->receiver_writer || !udata->patchbayWriter) {
             return luaL_error(L, "error creating writer for receiver");
         }
         receiver_capi->retainReceiver(receiver);
-        udata->receiver = receiver;
+        udata->receiver      = receiver;
+        udata->compactStatus = compactStatus;
     }
     
     jack_status_t status = {0};
@@ -106,11 +198,38 @@ static int LjackClient_open(lua_State* L)
         udata->bufferSize      = jack_get_buffer_size(udata->client);
         udata->audioBufferSize = jack_port_type_get_buffer_size(udata->client, JACK_DEFAULT_AUDIO_TYPE);
         udata->midiBufferSize  = jack_port_type_get_buffer_size(udata->client, JACK_DEFAULT_MIDI_TYPE);
+        udata->maxBufferSize   = udata->bufferSize;
+        if (maxBufferSize > (int)udata->maxBufferSize) {
+            udata->maxBufferSize = maxBufferSize;
+        }
+        ljack_arena_init(&udata->arena, 
+                         ljack_client_intern_procbuf_size(udata, true,  udata->maxBufferSize),
+                         ljack_client_intern_procbuf_size(udata, false, udata->maxBufferSize));
+        udata->graph = ljack_client_graph_new(udata->client);
         ljack_client_intern_register_callbacks(udata);
     }
     if (!udata->client) {
         return luaL_error(L, "cannot open jack client");
     }
+    if (!udata->graph) {
+        return luaL_error(L, "out of memory");
+    }
+    udata->events = ljack_client_events_start(udata);
+    if (!udata->events) {
+        return luaL_error(L, "cannot start event thread");
+    }
+    if (udata->receiver && (coalescingWindow > 0 || maxStatusRate > 0)) {
+        udata->coalescer = ljack_client_coalescer_start(udata, coalescingWindow, maxStatusRate);
+        if (!udata->coalescer) {
+            return luaL_error(L, "cannot start status coalescing thread");
+        }
+    }
+    if (workerThreads > 0) {
+        udata->workers = ljack_client_workers_start(udata, workerThreads);
+        if (!udata->workers) {
+            return luaL_error(L, "cannot start worker threads");
+        }
+    }
     return 1;
 }
 
@@ -120,9 +239,26 @@ static void internalClientClose(ClientUserData* udata)
 {
     if (udata->client) {
         if (udata->activated) {
-            async_mutex_lock  (&udata->processMutex);
-                ljack_client_intern_activate_proc_list_LOCKED(udata, NULL);
-            async_mutex_unlock(&udata->processMutex);
+            ljack_client_intern_publish_exec_list(udata, NULL);
+            ljack_client_intern_wait_for_retired_exec_lists(udata);
+        }
+        if (udata->workers) {
+            ljack_client_workers_stop(udata->workers);
+            udata->workers = NULL;
+        }
+        /* processors running in async lanes may still log through the event queue */
+        for (int i = 0; i < udata->procRegCount; ++i) {
+            LjackProcReg* reg = udata->procRegList[i];
+            if (reg->asyncLane) {
+                ljack_client_async_stop(reg->asyncLane);
+            }
+        }
+        if (udata->events) {
+            ljack_client_events_stop(udata->events);
+            udata->events = NULL;
+        }
+        if (udata->coalescer) {
+            ljack_client_coalescer_stop(udata->coalescer);
         }
         {
             PortUserData* p = udata->firstPortUserData;
@@ -175,21 +311,43 @@ static int LjackClient_release(lua_State* L)
                 ljack_client_intern_release_proc_reg(L, reg);
             }
             free(udata->procRegList);
-            udata->procRegList = NULL;
-            udata->activeProcRegList = NULL;
-            udata->confirmedProcRegList = NULL;
+            udata->procRegList     = NULL;
+            udata->procRegCapacity = 0;
+            LjackExecList* execList = atomic_set_ptr(&udata->activeExecList, NULL);
+            ljack_client_intern_free_exec_list(execList);
+            while (udata->retiredExecLists) {
+                LjackExecList* next = udata->retiredExecLists->nextRetired;
+                ljack_client_intern_free_exec_list(udata->retiredExecLists);
+                udata->retiredExecLists = next;
+            }
             udata->procRegCount = 0;
         }
+        ljack_client_intern_free_detached_proc_regs(udata);
         while (udata->firstPortUserData) {
             ljack_port_release(L, udata->firstPortUserData);
         }
         while (udata->firstProcBufUserData) {
             ljack_procbuf_release(L, udata->firstProcBufUserData);
         }
+        ljack_client_storage_free(udata);
+        if (udata->graph) {
+            ljack_client_graph_free(udata->graph);
+            udata->graph = NULL;
+        }
+        ljack_client_patchbay_free(udata);
+        if (udata->coalescer) {
+            ljack_client_coalescer_free(udata->coalescer);
+            udata->coalescer = NULL;
+        }
+        ljack_arena_free(&udata->arena);
         if (udata->receiver_writer) {
             udata->receiver_capi->freeWriter(udata->receiver_writer);
             udata->receiver_writer = NULL;
         }
+        if (udata->patchbayWriter) {
+            udata->receiver_capi->freeWriter(udata->patchbayWriter);
+            udata->patchbayWriter = NULL;
+        }
         if (udata->receiver) {
             udata->receiver_capi->releaseReceiver(udata->receiver);
             udata->receiver = NULL;
@@ -256,6 +414,10 @@ static int LjackClient_activate(lua_State* L)
         return luaL_error(L, "error: cannot activate client");
     }
     udata->activated = true;
+    if (udata->graph) {
+        /* changes before activation were not reported by callbacks */
+        ljack_client_graph_invalidate(udata->graph);
+    }
     return 0;
 }
 
@@ -270,6 +432,7 @@ static int LjackClient_deactivate(lua_State* L)
         return luaL_error(L, "error: cannot deactivate client");
     }
     udata->activated = false;
+    ljack_client_patchbay_deactivated(udata);
     return 0;
 }
 
@@ -481,18 +644,18 @@ static int LjackClient_port_by_id(lua_State* L)
 
 /* ============================================================================================ */
 
-static int LjackClient_get_ports(lua_State* L)
+static void checkPortQueryArgs(lua_State* L, int* argp, const char** name,
+                               const char** typeName, unsigned long* flags)
 {
-    int arg = 1;
-    ClientUserData* udata = checkClientUdata(L, arg++);
-    const char*        name = NULL;
-    int                type = -1;
-    int                dir  = -1;
+    int arg  = *argp;
+    int type = -1;
+    int dir  = -1;
+    *name = NULL;
     if (!lua_isnone(L, arg)) {
         if (lua_isnil(L, arg)) {
             ++arg;
         } else {
-            name = luaL_checkstring(L, arg++);
+            *name = luaL_checkstring(L, arg++);
         }
     }
     if (!lua_isnone(L, arg)) {
@@ -509,16 +672,27 @@ static int LjackClient_get_ports(lua_State* L)
             dir = luaL_checkoption(L, arg++, NULL, portDirections);
         }
     }
-    const char*   typeName = NULL;
-    unsigned long flags    = 0;
+    *typeName = NULL;
+    *flags    = 0;
     switch (type) {
-        case MIDI:  typeName = JACK_DEFAULT_MIDI_TYPE;  break;
-        case AUDIO: typeName = JACK_DEFAULT_AUDIO_TYPE; break;
+        case MIDI:  *typeName = JACK_DEFAULT_MIDI_TYPE;  break;
+        case AUDIO: *typeName = JACK_DEFAULT_AUDIO_TYPE; break;
     }
     switch (dir) {
-        case IN:  flags = JackPortIsInput;  break;
-        case OUT: flags = JackPortIsOutput; break;
+        case IN:  *flags = JackPortIsInput;  break;
+        case OUT: *flags = JackPortIsOutput; break;
     }
+    *argp = arg;
+}
+
+static int LjackClient_get_ports(lua_State* L)
+{
+    int arg = 1;
+    ClientUserData* udata = checkClientUdata(L, arg++);
+    const char*     name;
+    const char*     typeName;
+    unsigned long   flags;
+    checkPortQueryArgs(L, &arg, &name, &typeName, &flags);
 
     luaL_checkstack(L, 10, NULL);
     lua_pushcfunction(L, ljack_util_push_string_list); /* -> func ----  may cause mem error in lua 5.1 */
@@ -539,6 +713,127 @@ static int LjackClient_get_ports(lua_State* L)
 
 /* ============================================================================================ */
 
+typedef struct PortTableData
+{
+    jack_client_t* client;
+    const char**   ports;
+    const char**   connections;  /* of the current port, freed by the caller on error */
+} PortTableData;
+
+static const char* const PORT_TABLE_COLUMNS[] =
+{
+    "name", "uuid", "type", "direction", "flags", "client", "mine", "connections", NULL
+};
+
+static int pushPortTable(lua_State* L)
+{
+    PortTableData* data = lua_touserdata(L, 1);
+    
+    lua_newtable(L);                                           /* -> data, rslt */
+    int c;
+    for (c = 0; PORT_TABLE_COLUMNS[c]; ++c) {
+        lua_newtable(L);                                       /* -> data, rslt, column */
+        lua_setfield(L, -2, PORT_TABLE_COLUMNS[c]);            /* -> data, rslt */
+    }
+    for (c = 0; PORT_TABLE_COLUMNS[c]; ++c) {
+        lua_getfield(L, 2, PORT_TABLE_COLUMNS[c]);             /* -> data, rslt, columns... */
+    }
+    const int nameCol = 3, uuidCol = 4, typeCol = 5, dirCol = 6, flagsCol = 7,
+              clientCol = 8, mineCol = 9, conCol = 10;
+    int n = 0;
+    for (int i = 0; data->ports[i]; ++i) {
+        const char*  name = data->ports[i];
+        jack_port_t* port = jack_port_by_name(data->client, name);
+        if (!port) {
+            /* unregistered in the meantime */
+            continue;
+        }
+        ++n;
+        int          portFlags = jack_port_flags(port);
+        const char*  type      = jack_port_type(port);
+        const char*  colon     = strchr(name, ':');
+        
+        lua_pushstring(L, name);
+        lua_rawseti(L, nameCol, n);
+        
+        lua_pushinteger(L, (lua_Integer)jack_port_uuid(port));
+        lua_rawseti(L, uuidCol, n);
+        
+        if (type && strcmp(type, JACK_DEFAULT_AUDIO_TYPE) == 0) {
+            lua_pushstring(L, "AUDIO");
+        } else if (type && strcmp(type, JACK_DEFAULT_MIDI_TYPE) == 0) {
+            lua_pushstring(L, "MIDI");
+        } else {
+            lua_pushstring(L, type ? type : "");
+        }
+        lua_rawseti(L, typeCol, n);
+        
+        lua_pushstring(L, (portFlags & JackPortIsInput) ? "IN" : "OUT");
+        lua_rawseti(L, dirCol, n);
+        
+        lua_pushinteger(L, portFlags);
+        lua_rawseti(L, flagsCol, n);
+        
+        if (colon) {
+            lua_pushlstring(L, name, colon - name);
+        } else {
+            lua_pushstring(L, "");
+        }
+        lua_rawseti(L, clientCol, n);
+        
+        lua_pushboolean(L, jack_port_is_mine(data->client, port));
+        lua_rawseti(L, mineCol, n);
+        
+        lua_newtable(L);                                       /* -> ..., connections */
+        data->connections = jack_port_get_all_connections(data->client, port);
+        if (data->connections) {
+            for (int j = 0; data->connections[j]; ++j) {
+                lua_pushstring(L, data->connections[j]);
+                lua_rawseti(L, -2, j + 1);
+            }
+            jack_free(data->connections);
+            data->connections = NULL;
+        }
+        lua_rawseti(L, conCol, n);                             /* -> ... */
+    }
+    lua_settop(L, 2);                                          /* -> data, rslt */
+    lua_pushinteger(L, n);                                     /* -> data, rslt, n */
+    lua_setfield(L, -2, "count");                              /* -> data, rslt */
+    return 1;
+}
+
+static int LjackClient_get_port_table(lua_State* L)
+{
+    int arg = 1;
+    ClientUserData* udata = checkClientUdata(L, arg++);
+    const char*     name;
+    const char*     typeName;
+    unsigned long   flags;
+    checkPortQueryArgs(L, &arg, &name, &typeName, &flags);
+
+    luaL_checkstack(L, 20, NULL);
+    lua_pushcfunction(L, pushPortTable);     /* -> func ----  may cause mem error in lua 5.1 */
+
+    static const char* emptyList[] = { NULL };
+    const char** ports = jack_get_ports(udata->client, name, typeName, flags);
+
+    PortTableData data = { udata->client, ports ? ports : emptyList, NULL };
+    lua_pushlightuserdata(L, &data);         /* -> func, data */
+    int rc = lua_pcall(L, 1, 1, 0);          /* -> rslt */
+    if (data.connections) {
+        jack_free(data.connections);
+    }
+    if (ports) {
+        jack_free(ports);
+    }
+    if (rc != LUA_OK) {
+        return lua_error(L);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
 
 static int LjackClient_connect(lua_State* L)
 {
@@ -605,6 +900,72 @@ static int LjackClient_get_connections(lua_State* L)
 
 /* ============================================================================================ */
 
+static int LjackClient_apply_connections(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    return ljack_client_patchbay_apply(L, udata, 2);
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_graph_generation(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    lua_Integer     generation;
+    if (!ljack_client_graph_generation(udata->graph, udata->activated, &generation)) {
+        return luaL_error(L, "out of memory");
+    }
+    lua_pushinteger(L, generation);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_graph_is_connected(lua_State* L)
+{
+    int arg = 1;
+    ClientUserData* udata = checkClientUdata(L, arg++);
+    const char*     p1    = ljack_port_name_from_arg(L, arg++);
+    const char*     p2    = ljack_port_name_from_arg(L, arg++);
+
+    bool rslt;
+    if (!ljack_client_graph_is_connected(udata->graph, udata->activated, p1, p2, &rslt)) {
+        return luaL_error(L, "out of memory");
+    }
+    lua_pushboolean(L, rslt);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_graph_get_connections(lua_State* L)
+{
+    int arg = 1;
+    ClientUserData* udata = checkClientUdata(L, arg++);
+    const char*     name  = ljack_port_name_from_arg(L, arg++);
+
+    luaL_checkstack(L, 10, NULL);
+    lua_pushcfunction(L, ljack_util_push_string_list); /* -> func ----  may cause mem error in lua 5.1 */
+
+    const char** ports;
+    if (!ljack_client_graph_get_connections(udata->graph, udata->activated, name, &ports)) {
+        return luaL_error(L, "out of memory");
+    }
+    if (!ports) {
+        lua_newtable(L);                  /* -> func, table */
+        return 1;
+    }
+    lua_pushlightuserdata(L, ports);      /* -> func, ports */
+    int rc = lua_pcall(L, 1, 1, 0);       /* -> rslt */
+    free(ports);
+    if (rc != LUA_OK) {
+        return lua_error(L);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
 static int LjackClient_get_time(lua_State* L)
 {
     ClientUserData* udata = checkClientUdata(L, 1); // Crash in jack_get_time if no client was created
@@ -644,7 +1005,18 @@ static int LjackClient_set_buffer_size(lua_State* L)
 {
     ClientUserData* udata = checkClientUdata(L, 1);
     jack_nframes_t newSize = luaL_checkinteger(L, 2);
+    
+    /* preallocate storage for the buffer size callback */
+    if (newSize > udata->maxBufferSize) {
+        async_mutex_lock(&udata->processMutex);
+            bool ok = ljack_client_intern_reserve_procbufs_LOCKED(udata, newSize);
+        async_mutex_unlock(&udata->processMutex);
+        if (!ok) {
+            return luaL_error(L, "error allocating process buffers");
+        }
+    }
     int rc = jack_set_buffer_size(udata->client, newSize);
+    ljack_client_intern_free_retired_procbufs(udata);
     if (rc != 0) {
         return luaL_error(L, "error setting buffer size");
     }
@@ -662,11 +1034,104 @@ static int LjackClient_cpu_load(lua_State* L)
 
 /* ============================================================================================ */
 
+static void pushProcStats(lua_State* L, LjackProcStats* stats)
+{
+    lua_newtable(L);                                                   /* -> entry */
+    lua_pushinteger(L, (lua_Integer)stats->count);                     /* -> entry, value */
+    lua_setfield(L, -2, "count");                                      /* -> entry */
+    lua_pushnumber(L, stats->lastNanos / 1000.0);
+    lua_setfield(L, -2, "last");
+    lua_pushnumber(L, stats->count ? (stats->sumNanos / 1000.0) / stats->count : 0.0);
+    lua_setfield(L, -2, "mean");
+    lua_pushnumber(L, stats->maxNanos / 1000.0);
+    lua_setfield(L, -2, "max");
+    lua_createtable(L, LJACK_PROC_STATS_BUCKETS, 0);                   /* -> entry, histogram */
+    for (int i = 0; i < LJACK_PROC_STATS_BUCKETS; ++i) {
+        lua_pushinteger(L, (lua_Integer)stats->histogram[i]);          /* -> entry, histogram, value */
+        lua_rawseti(L, -2, i + 1);                                     /* -> entry, histogram */
+    }
+    lua_setfield(L, -2, "histogram");                                  /* -> entry */
+}
+
+static int LjackClient_get_processor_stats(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    bool            reset = lua_toboolean(L, 2);
+    
+    lua_newtable(L);                                                   /* -> result */
+    for (int i = 0; i < udata->procRegCount; ++i) {
+        LjackProcReg*  reg = udata->procRegList[i];
+        LjackProcStats stats;
+        ljack_client_intern_read_proc_stats(reg, &stats);
+        if (reset) {
+            atomic_set(&reg->stats.resetRequested, 1);
+        }
+        lua_pushstring(L, reg->processorName);                         /* -> result, name */
+        for (int n = 2; ; ++n) {
+            lua_pushvalue(L, -1);                                      /* -> result, name, name */
+            lua_rawget(L, -3);                                         /* -> result, name, existing */
+            bool exists = !lua_isnil(L, -1);
+            lua_pop(L, 1);                                             /* -> result, name */
+            if (!exists) {
+                break;
+            }
+            lua_pop(L, 1);                                             /* -> result */
+            lua_pushfstring(L, "%s#%d", reg->processorName, n);        /* -> result, name */
+        }
+        pushProcStats(L, &stats);                                      /* -> result, name, entry */
+        lua_pushinteger(L, ljack_client_intern_get_latency(udata, reg));  /* -> result, name, entry, latency */
+        lua_setfield(L, -2, "latency");                                /* -> result, name, entry */
+        if (reg->asyncLane) {
+            lua_pushinteger(L, ljack_client_async_get_missed(reg->asyncLane));
+            lua_setfield(L, -2, "missed");                             /* -> result, name, entry */
+        }
+        lua_rawset(L, -3);                                             /* -> result */
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
 static int LjackClient_new_procbuf(lua_State* L)
 {
     int arg = 1;
     ClientUserData* clientUdata = checkClientUdata(L, arg++);
-    int type = luaL_checkoption(L, arg, "AUDIO", portTypes);
+    int type = -1;
+    if (!ljack_is_port_udata(L, arg)) {
+        type = luaL_checkoption(L, arg++, "AUDIO", portTypes);
+    }
+    int           portArg   = 0;
+    PortUserData* portUdata = NULL;
+    int           writers   = 1;
+    if (lua_type(L, arg) == LUA_TNUMBER) {
+        writers = luaL_checkinteger(L, arg);
+        if (type != MIDI) {
+            return luaL_argerror(L, arg, "multiple writers are only supported for MIDI process buffers");
+        }
+        if (writers < 1 || writers > LJACK_MIDI_MERGE_MAX_INPUTS) {
+            return luaL_argerror(L, arg, "invalid number of writers");
+        }
+    }
+    else if (!lua_isnoneornil(L, arg)) {
+        if (!ljack_is_port_udata(L, arg)) {
+            return luaL_argerror(L, arg, "port or number expected");
+        }
+        portArg   = arg;
+        portUdata = lua_touserdata(L, arg);
+        if (   !portUdata->port || portUdata->clientUserData != clientUdata
+            || !jack_port_is_mine(portUdata->client, portUdata->port))
+        {
+            return luaL_argerror(L, arg, "port is not owned by this client");
+        }
+        if (portUdata->isOutput && portUdata->procUsageCounter > 0) {
+            return luaL_argerror(L, arg, "port is used by processor");
+        }
+        int portType = portUdata->isMidi ? MIDI : AUDIO;
+        if (type >= 0 && type != portType) {
+            return luaL_argerror(L, arg, "port type mismatch");
+        }
+        type = portType;
+    }
 
     ProcBufUserData* procBufUdata = ljack_procbuf_create(L);
     
@@ -674,18 +1139,42 @@ static int LjackClient_new_procbuf(lua_State* L)
         case MIDI:  procBufUdata->isMidi  = true; break;
         case AUDIO: procBufUdata->isAudio = true; break;
     }
+    if (portUdata) {
+        /* alias: processors get the port's buffer directly, no storage needed */
+        lua_pushvalue(L, portArg);
+        procBufUdata->aliasPortRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        procBufUdata->aliasPort    = portUdata;
+        portUdata->procUsageCounter += 1;
+    }
     async_mutex_lock(&clientUdata->processMutex);
     {
-        size_t size = procBufUdata->isAudio ? clientUdata->audioBufferSize 
-                                            : clientUdata->midiBufferSize;
-        procBufUdata->ringBuffer = jack_ringbuffer_create(size);
-        if (procBufUdata->ringBuffer) {
-            jack_ringbuffer_mlock(procBufUdata->ringBuffer);
-            ljack_procbuf_clear_midi_events(procBufUdata);
-        } else {
+        /* each writer gets storage of its own in the arena */
+        if (writers > 1 && !ljack_procbuf_alloc_segments_LOCKED(procBufUdata, &clientUdata->arena, writers,
+                                                                clientUdata->midiBufferSize))
+        {
             async_mutex_unlock(&clientUdata->processMutex);
             return luaL_error(L, "error allocating process buffer");
         }
+        if (!portUdata && clientUdata->shareProcBufs) {
+            /* storage is assigned with the exec list */
+            procBufUdata->sharedStorage = true;
+            procBufUdata->bufferLength  = procBufUdata->isAudio ? clientUdata->audioBufferSize 
+                                                                : clientUdata->midiBufferSize;
+        }
+        else if (!portUdata) {
+            procBufUdata->arenaSlot = ljack_arena_alloc_LOCKED(&clientUdata->arena, procBufUdata->isAudio,
+                                                               &procBufUdata->buffer);
+            if (procBufUdata->arenaSlot >= 0) {
+                procBufUdata->bufferLength = procBufUdata->isAudio ? clientUdata->audioBufferSize 
+                                                                   : clientUdata->midiBufferSize;
+                ljack_procbuf_clear_midi_events(procBufUdata);
+            } else {
+                ljack_procbuf_free_segments_LOCKED(procBufUdata, &clientUdata->arena);
+                async_mutex_unlock(&clientUdata->processMutex);
+                return luaL_error(L, "error allocating process buffer");
+            }
+        }
+
         connectProcBufUserData(L, clientUdata, procBufUdata);
         procBufUdata->processMutex = &clientUdata->processMutex;
         procBufUdata->jackClient = clientUdata->client;
@@ -697,6 +1186,58 @@ static int LjackClient_new_procbuf(lua_State* L)
 
 /* ============================================================================================ */
 
+static int LjackClient_new_matrix_mixer(lua_State* L)
+{
+    checkClientUdata(L, 1);
+    return ljack_matrix_mixer_new(L, 1, 2, 3);
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_begin_transaction(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    ljack_client_intern_begin_transaction(L, udata);
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_commit_transaction(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    ljack_client_intern_commit_transaction(L, udata);
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackClient_transaction(lua_State* L)
+{
+    ClientUserData* udata = checkClientUdata(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    int nargs = lua_gettop(L) - 2;
+
+    ljack_client_intern_begin_transaction(L, udata);
+    int depth = udata->transactionDepth;
+    int rc    = lua_pcall(L, nargs, LUA_MULTRET, 0);         /* -> client, rslts... */
+
+    /* transactions that were begun by func and not committed are ended too */
+    while (udata->transactionDepth >= depth) {
+        if (rc == LUA_OK && udata->transactionDepth == depth) {
+            ljack_client_intern_commit_transaction(L, udata);
+        } else {
+            ljack_client_intern_abort_transaction(udata);
+        }
+    }
+    if (rc != LUA_OK) {
+        return lua_error(L);
+    }
+    return lua_gettop(L) - 1;
+}
+
+/* ============================================================================================ */
+
 static const luaL_Reg LjackClientMethods[] = 
 {
     { "id",                  LjackClient_id                 },
@@ -710,18 +1251,28 @@ static const luaL_Reg LjackClientMethods[] =
     { "port_register",       LjackClient_port_register      },
     { "port_by_name",        LjackClient_port_by_name       },
     { "port_by_id",          LjackClient_port_by_id         },
+    { "get_port_table",      LjackClient_get_port_table     },
     { "get_ports",           LjackClient_get_ports          },
     { "connect",             LjackClient_connect            },
     { "disconnect",          LjackClient_disconnect         },
     { "is_connected",        LjackClient_is_connected       },
     { "get_connections",     LjackClient_get_connections    },
+    { "apply_connections",   LjackClient_apply_connections  },
+    { "graph_generation",    LjackClient_graph_generation   },
+    { "graph_is_connected",  LjackClient_graph_is_connected },
+    { "graph_get_connections", LjackClient_graph_get_connections },
     { "get_time",            LjackClient_get_time           },
     { "frame_time",          LjackClient_frame_time         },
     { "get_sample_rate",     LjackClient_get_sample_rate    },
     { "get_buffer_size",     LjackClient_get_buffer_size    },
     { "set_buffer_size",     LjackClient_set_buffer_size    },
     { "cpu_load",            LjackClient_cpu_load           },
+    { "get_processor_stats", LjackClient_get_processor_stats },
     { "new_process_buffer",  LjackClient_new_procbuf        },
+    { "new_matrix_mixer",    LjackClient_new_matrix_mixer   },
+    { "begin_transaction",   LjackClient_begin_transaction  },
+    { "commit_transaction",  LjackClient_commit_transaction },
+    { "transaction",         LjackClient_transaction        },
 
     { NULL,         NULL } /* sentinel */
 };
@@ -7,6 +7,10 @@ typedef struct LjackClientUserData    LjackClientUserData;
 
 extern const char* const LJACK_CLIENT_CLASS_NAME;
 
+#define LJACK_MAX_BUFFER_SIZE 65536
+
+#define LJACK_DEFAULT_MIN_SUB_BLOCK_SIZE 32
+
 int ljack_client_init_module(lua_State* L, int module);
 
 void ljack_client_check_is_valid(lua_State* L, LjackClientUserData* udata);
@@ -0,0 +1,299 @@
+/* async_defines.h must be included first */
+#include "async_defines.h"
+
+#if defined(LJACK_ASYNC_USE_WIN32)
+    #include <malloc.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#include "util.h"
+#include "client_arena.h"
+
+typedef LjackArenaPool ArenaPool;
+
+/* ============================================================================================ */
+
+static size_t alignedSize(size_t size)
+{
+    if (size == 0) {
+        size = 1;
+    }
+    return (size + LJACK_ARENA_ALIGNMENT - 1) & ~(size_t)(LJACK_ARENA_ALIGNMENT - 1);
+}
+
+static char* allocChunk(size_t slotSize)
+{
+    size_t size = slotSize * LJACK_ARENA_CHUNK_SLOTS;
+#if defined(LJACK_ASYNC_USE_WIN32)
+    char* chunk = _aligned_malloc(size, LJACK_ARENA_ALIGNMENT);
+    if (chunk) {
+        VirtualLock(chunk, size);
+    }
+    return chunk;
+#else
+    void* chunk = NULL;
+    if (posix_memalign(&chunk, LJACK_ARENA_ALIGNMENT, size) != 0) {
+        return NULL;
+    }
+    mlock(chunk, size);
+    return chunk;
+#endif
+}
+
+static void freeChunk(char* chunk, size_t slotSize)
+{
+    size_t size = slotSize * LJACK_ARENA_CHUNK_SLOTS;
+#if defined(LJACK_ASYNC_USE_WIN32)
+    VirtualUnlock(chunk, size);
+    _aligned_free(chunk);
+#else
+    munlock(chunk, size);
+    free(chunk);
+#endif
+}
+
+static void freeChunks(char** chunks, int count, size_t slotSize)
+{
+    if (chunks) {
+        for (int i = 0; i < count; ++i) {
+            if (chunks[i]) {
+                freeChunk(chunks[i], slotSize);
+            }
+        }
+        free(chunks);
+    }
+}
+
+static ArenaPool* getPool(LjackArena* arena, bool isAudio)
+{
+    return isAudio ? &arena->audio : &arena->midi;
+}
+
+/* ============================================================================================ */
+
+void ljack_arena_init(LjackArena* arena, size_t audioSlotSize, size_t midiSlotSize)
+{
+    memset(arena, 0, sizeof(LjackArena));
+    arena->audio.slotSize = alignedSize(audioSlotSize);
+    arena->midi.slotSize  = alignedSize(midiSlotSize);
+}
+
+/* ============================================================================================ */
+
+static bool addChunk(ArenaPool* pool)
+{
+    if (pool->chunkCount == pool->chunkCapacity) {
+        int newCapacity = 2 * pool->chunkCapacity;
+        if (newCapacity < 4) {
+            newCapacity = 4;
+        }
+        char**  newChunks = realloc(pool->chunks, newCapacity * sizeof(char*));
+        if (!newChunks) {
+            return false;
+        }
+        pool->chunks = newChunks;
+        char*** newOwners = realloc(pool->owners, newCapacity * LJACK_ARENA_CHUNK_SLOTS * sizeof(char**));
+        if (!newOwners) {
+            return false;
+        }
+        pool->owners = newOwners;
+        if (pool->spareChunks) {
+            char** newSpares = realloc(pool->spareChunks, newCapacity * sizeof(char*));
+            if (!newSpares) {
+                return false;
+            }
+            pool->spareChunks = newSpares;
+        }
+        pool->chunkCapacity = newCapacity;
+    }
+    char* chunk = allocChunk(pool->slotSize);
+    if (!chunk) {
+        return false;
+    }
+    if (pool->spareChunks) {
+        /* a buffer size change is pending, spare chunk is needed too */
+        char* spare = allocChunk(pool->spareSlotSize);
+        if (!spare) {
+            freeChunk(chunk, pool->slotSize);
+            return false;
+        }
+        pool->spareChunks[pool->chunkCount] = spare;
+    }
+    int firstSlot = pool->chunkCount * LJACK_ARENA_CHUNK_SLOTS;
+    for (int s = 0; s < LJACK_ARENA_CHUNK_SLOTS; ++s) {
+        pool->owners[firstSlot + s] = NULL;
+    }
+    pool->chunks[pool->chunkCount++] = chunk;
+    return true;
+}
+
+int ljack_arena_alloc_LOCKED(LjackArena* arena, bool isAudio, char** owner)
+{
+    ArenaPool* pool = getPool(arena, isAudio);
+
+    if (pool->usedCount == pool->chunkCount * LJACK_ARENA_CHUNK_SLOTS) {
+        if (!addChunk(pool)) {
+            return -1;
+        }
+    }
+    int slotCount = pool->chunkCount * LJACK_ARENA_CHUNK_SLOTS;
+    for (int slot = 0; slot < slotCount; ++slot) {
+        if (!pool->owners[slot]) {
+            int c = slot / LJACK_ARENA_CHUNK_SLOTS;
+            int s = slot % LJACK_ARENA_CHUNK_SLOTS;
+            pool->owners[slot] = owner;
+            pool->usedCount   += 1;
+            *owner = pool->chunks[c] + s * pool->slotSize;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void ljack_arena_free_LOCKED(LjackArena* arena, bool isAudio, int slot)
+{
+    ArenaPool* pool = getPool(arena, isAudio);
+    if (slot >= 0 && pool->owners[slot]) {
+        *pool->owners[slot] = NULL;
+        pool->owners[slot]  = NULL;
+        pool->usedCount    -= 1;
+    }
+}
+
+/* ============================================================================================ */
+
+static int compareSlots(const void* a, const void* b)
+{
+    int sa = *(const int*)a;
+    int sb = *(const int*)b;
+    return (sa < sb) ? -1 : (sa > sb) ? 1 : 0;
+}
+
+void ljack_arena_reorder_LOCKED(LjackArena* arena, bool isAudio, int count, 
+                                char** owners[], int slots[], char* buffers[])
+{
+    ArenaPool* pool = getPool(arena, isAudio);
+    qsort(slots, count, sizeof(int), compareSlots);
+    for (int i = 0; i < count; ++i) {
+        int slot = slots[i];
+        int c    = slot / LJACK_ARENA_CHUNK_SLOTS;
+        int s    = slot % LJACK_ARENA_CHUNK_SLOTS;
+        pool->owners[slot] = owners[i];
+        buffers[i]         = pool->chunks[c] + s * pool->slotSize;
+    }
+}
+
+/* ============================================================================================ */
+
+static bool reservePool(ArenaPool* pool, size_t slotSize)
+{
+    slotSize = alignedSize(slotSize);
+    if (slotSize <= pool->slotSize) {
+        return true;
+    }
+    if (pool->chunkCount == 0) {
+        pool->slotSize = slotSize;
+        return true;
+    }
+    if (pool->spareChunks && pool->spareSlotSize >= slotSize) {
+        return true;
+    }
+    char** spares = calloc(pool->chunkCapacity, sizeof(char*));
+    if (!spares) {
+        return false;
+    }
+    for (int c = 0; c < pool->chunkCount; ++c) {
+        spares[c] = allocChunk(slotSize);
+        if (!spares[c]) {
+            freeChunks(spares, c, slotSize);
+            return false;
+        }
+    }
+    freeChunks(pool->spareChunks, pool->chunkCount, pool->spareSlotSize);
+    pool->spareChunks   = spares;
+    pool->spareSlotSize = slotSize;
+    return true;
+}
+
+bool ljack_arena_reserve_LOCKED(LjackArena* arena, size_t audioSlotSize, size_t midiSlotSize)
+{
+    return    reservePool(&arena->audio, audioSlotSize)
+           && reservePool(&arena->midi,  midiSlotSize);
+}
+
+/* ============================================================================================ */
+
+static void resizePool(ArenaPool* pool)
+{
+    if (pool->spareChunks) {
+        freeChunks(pool->retiredChunks, pool->retiredCount, pool->retiredSlotSize);
+        pool->retiredChunks   = pool->chunks;
+        pool->retiredCount    = pool->chunkCount;
+        pool->retiredSlotSize = pool->slotSize;
+        pool->chunks          = pool->spareChunks;
+        pool->slotSize        = pool->spareSlotSize;
+        pool->spareChunks     = NULL;
+        pool->spareSlotSize   = 0;
+
+        int slotCount = pool->chunkCount * LJACK_ARENA_CHUNK_SLOTS;
+        for (int slot = 0; slot < slotCount; ++slot) {
+            if (pool->owners[slot]) {
+                int c = slot / LJACK_ARENA_CHUNK_SLOTS;
+                int s = slot % LJACK_ARENA_CHUNK_SLOTS;
+                *pool->owners[slot] = pool->chunks[c] + s * pool->slotSize;
+            }
+        }
+    }
+}
+
+void ljack_arena_resize_LOCKED(LjackArena* arena)
+{
+    resizePool(&arena->audio);
+    resizePool(&arena->midi);
+}
+
+/* ============================================================================================ */
+
+static void freeRetired(ArenaPool* pool)
+{
+    freeChunks(pool->retiredChunks, pool->retiredCount, pool->retiredSlotSize);
+    pool->retiredChunks = NULL;
+    pool->retiredCount  = 0;
+}
+
+void ljack_arena_free_retired_LOCKED(LjackArena* arena)
+{
+    freeRetired(&arena->audio);
+    freeRetired(&arena->midi);
+}
+
+/* ============================================================================================ */
+
+static void freePool(ArenaPool* pool)
+{
+    int slotCount = pool->chunkCount * LJACK_ARENA_CHUNK_SLOTS;
+    for (int slot = 0; slot < slotCount; ++slot) {
+        if (pool->owners[slot]) {
+            *pool->owners[slot] = NULL;
+        }
+    }
+    freeRetired(pool);
+    freeChunks(pool->chunks,      pool->chunkCount, pool->slotSize);
+    freeChunks(pool->spareChunks, pool->chunkCount, pool->spareSlotSize);
+    free(pool->owners);
+    pool->chunks        = NULL;
+    pool->spareChunks   = NULL;
+    pool->owners        = NULL;
+    pool->chunkCount    = 0;
+    pool->chunkCapacity = 0;
+    pool->usedCount     = 0;
+}
+
+void ljack_arena_free(LjackArena* arena)
+{
+    freePool(&arena->audio);
+    freePool(&arena->midi);
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,84 @@
+#ifndef LJACK_CLIENT_ARENA_H
+#define LJACK_CLIENT_ARENA_H
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Storage for the process buffers of one client. Buffers are slots of equal size
+ * within large chunks of locked memory. Slots are 64 byte aligned and are handed out
+ * lowest index first. Slots can be reassigned among their owners, e.g. for laying
+ * out the buffers in execution order.
+ *
+ * Every slot knows the address of its owner's buffer pointer, so that all slots can
+ * be moved into larger chunks when the buffer size grows.
+ */
+
+#define LJACK_ARENA_ALIGNMENT   64
+#define LJACK_ARENA_CHUNK_SLOTS 16
+
+typedef struct LjackArenaPool
+{
+    size_t  slotSize;         /* multiple of LJACK_ARENA_ALIGNMENT */
+    int     chunkCount;
+    int     chunkCapacity;
+    char**  chunks;           /* LJACK_ARENA_CHUNK_SLOTS slots each */
+    char*** owners;           /* per slot: address of the owner's buffer pointer, NULL if free */
+    int     usedCount;
+
+    size_t  spareSlotSize;
+    char**  spareChunks;      /* prepared for a larger buffer size, chunkCount entries */
+    size_t  retiredSlotSize;
+    char**  retiredChunks;    /* replaced chunks, to be freed on the Lua thread */
+    int     retiredCount;
+
+} LjackArenaPool;
+
+typedef struct LjackArena
+{
+    LjackArenaPool audio;
+    LjackArenaPool midi;
+
+} LjackArena;
+
+/* ============================================================================================ */
+
+void ljack_arena_init(LjackArena* arena, size_t audioSlotSize, size_t midiSlotSize);
+
+/**
+ * Allocates a slot and stores its address in *owner. Returns the slot index
+ * or -1 if memory could not be allocated.
+ */
+int ljack_arena_alloc_LOCKED(LjackArena* arena, bool isAudio, char** owner);
+
+void ljack_arena_free_LOCKED(LjackArena* arena, bool isAudio, int slot);
+
+/**
+ * Gives the lowest of the slots in slots to owners[0], the next one to owners[1]
+ * and so on. slots contains the owners' slot indices and is sorted, the new 
+ * addresses are stored in buffers. The owners' buffer pointers are not modified.
+ */
+void ljack_arena_reorder_LOCKED(LjackArena* arena, bool isAudio, int count, 
+                                char** owners[], int slots[], char* buffers[]);
+
+/**
+ * Preallocates larger chunks for the given slot sizes. The slots in use are
+ * not modified, i.e. if allocation fails, the arena remains usable.
+ */
+bool ljack_arena_reserve_LOCKED(LjackArena* arena, size_t audioSlotSize, size_t midiSlotSize);
+
+/**
+ * Moves all slots into the chunks prepared by ljack_arena_reserve_LOCKED() and
+ * updates the owners' buffer pointers. Must not be called while the process
+ * thread is running.
+ */
+void ljack_arena_resize_LOCKED(LjackArena* arena);
+
+void ljack_arena_free_retired_LOCKED(LjackArena* arena);
+
+void ljack_arena_free(LjackArena* arena);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_ARENA_H */
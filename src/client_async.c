@@ -0,0 +1,342 @@
+#include <jack/jack.h>
+#include <jack/thread.h>
+
+#include "util.h"
+#include "receiver_capi.h"
+
+#include "client_intern.h"
+#include "client_async.h"
+#include "main.h"
+
+/* ============================================================================================ */
+
+typedef struct AsyncBuffers
+{
+    jack_nframes_t  capacity;        /* frames per connector and slot */
+    float*          data;            /* slotCount * connectorCount * capacity */
+
+} AsyncBuffers;
+
+struct LjackAsyncLane
+{
+    LjackClientUserData*  udata;
+    LjackProcReg*         reg;
+    void*                 processorData;
+    int                 (*processCallback)(jack_nframes_t nframes, void* processorData);
+
+    int                   delay;
+    int                   slotCount;       /* delay + 1 */
+    int                   connectorCount;
+    AsyncBuffers*         buffers;         /* only exchanged while all slots are held */
+    AtomicPtr             spareBuffers;    /* AsyncBuffers*, prepared for a larger buffer size */
+    AtomicPtr             retiredBuffers;  /* AsyncBuffers*, replaced, to be freed on the Lua thread */
+    jack_nframes_t*       slotFrames;
+    AtomicCounter*        slotJob;         /* cycle whose inputs are in the slot */
+    AtomicCounter*        slotDone;        /* cycle that was processed in the slot */
+    AtomicCounter*        slotBusy;        /* slot is accessed by the process thread or the worker */
+    LjackAsyncConnector*  connectors;
+
+    /* only used in the JACK process thread */
+    int                   cycle;
+    int                   activeCycles;
+
+    AtomicCounter         submitted;       /* most recent cycle given to the worker */
+    AtomicCounter         missed;
+    AtomicCounter         errorRc;
+
+    /* only used in the worker thread */
+    int                   workerSlot;
+
+    bool                  semaphoreInitialized;
+    bool                  started;
+    jack_native_thread_t  thread;
+    Semaphore             semaphore;
+    AtomicCounter         shouldTerminate;
+};
+
+/* ============================================================================================ */
+
+static AsyncBuffers* allocBuffers(LjackAsyncLane* lane, jack_nframes_t capacity)
+{
+    size_t        frames = (size_t)lane->slotCount * lane->connectorCount * capacity;
+    AsyncBuffers* b      = calloc(1, sizeof(AsyncBuffers) + (frames + 1) * sizeof(float));
+    if (b) {
+        b->capacity = capacity;
+        b->data     = (float*)(b + 1);
+    }
+    return b;
+}
+
+static float* slotBuffer(LjackAsyncLane* lane, int slot, int index)
+{
+    AsyncBuffers* b = lane->buffers;
+    return b->data + ((size_t)slot * lane->connectorCount + index) * b->capacity;
+}
+
+static int slotOf(LjackAsyncLane* lane, int cycle)
+{
+    return (int)((unsigned)cycle % (unsigned)lane->slotCount);
+}
+
+/* ============================================================================================ */
+
+static void* workerThread(void* arg)
+{
+    LjackAsyncLane* lane    = arg;
+    int             lastJob = 0;
+    ljack_client_intern_mark_processing_thread();
+    while (true) {
+        async_semaphore_wait(&lane->semaphore);
+        if (atomic_get(&lane->shouldTerminate)) {
+            break;
+        }
+        int job = atomic_get(&lane->submitted);
+        if (job == lastJob || atomic_get(&lane->errorRc) != 0) {
+            continue;
+        }
+        int slot = slotOf(lane, job);
+        if (!atomic_set_if_equal(&lane->slotBusy[slot], 0, 1)) {
+            continue;
+        }
+        /* the process thread may have given newer inputs in the meantime */
+        job = atomic_get(&lane->slotJob[slot]);
+        if (job == lastJob) {
+            atomic_set(&lane->slotBusy[slot], 0);
+            continue;
+        }
+        lane->workerSlot = slot;
+
+        uint64_t t0 = async_clock_nanos();
+        int      rc = lane->processCallback(lane->slotFrames[slot], lane->processorData);
+        uint64_t t1 = async_clock_nanos();
+        ljack_client_intern_update_proc_stats(&lane->reg->stats, t1 - t0);
+
+        if (rc != 0) {
+            atomic_set(&lane->errorRc, rc);
+        } else {
+            atomic_set(&lane->slotDone[slot], job);
+        }
+        atomic_set(&lane->slotBusy[slot], 0);
+        lastJob = job;
+    }
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+LjackAsyncLane* ljack_client_async_start(LjackClientUserData* udata, LjackProcReg* reg, int delay)
+{
+    LjackAsyncLane* lane = calloc(1, sizeof(LjackAsyncLane));
+    if (!lane) {
+        return NULL;
+    }
+    int n     = reg->connectorCount;
+    int slots = delay + 1;
+
+    lane->udata           = udata;
+    lane->reg             = reg;
+    lane->processorData   = reg->processorData;
+    lane->processCallback = reg->processCallback;
+    lane->delay           = delay;
+    lane->slotCount       = slots;
+    lane->connectorCount  = n;
+    lane->buffers         = allocBuffers(lane, udata->maxBufferSize);
+    lane->slotFrames      = calloc(slots,      sizeof(jack_nframes_t));
+    lane->slotJob         = calloc(slots,      sizeof(AtomicCounter));
+    lane->slotDone        = calloc(slots,      sizeof(AtomicCounter));
+    lane->slotBusy        = calloc(slots,      sizeof(AtomicCounter));
+    lane->connectors      = calloc(n + 1,      sizeof(LjackAsyncConnector));
+    if (!lane->buffers || !lane->slotFrames || !lane->slotJob || !lane->slotDone || !lane->slotBusy || !lane->connectors) {
+        ljack_client_async_free(lane);
+        return NULL;
+    }
+    for (int i = 0; i < n; ++i) {
+        lane->connectors[i].lane  = lane;
+        lane->connectors[i].index = i;
+    }
+    async_semaphore_init(&lane->semaphore);
+    lane->semaphoreInitialized = true;
+
+    int rc = jack_client_create_thread(udata->client, &lane->thread, 0, 0, workerThread, lane);
+    if (rc != 0) {
+        ljack_log_error("LJACK: cannot create thread for processor '%s' (error %d).", reg->processorName, rc);
+        ljack_client_async_free(lane);
+        return NULL;
+    }
+    lane->started = true;
+    return lane;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_async_stop(LjackAsyncLane* lane)
+{
+    if (lane->started) {
+        atomic_set(&lane->shouldTerminate, 1);
+        async_semaphore_post(&lane->semaphore);
+        jack_client_stop_thread(lane->udata->client, lane->thread);
+        lane->started = false;
+    }
+}
+
+void ljack_client_async_free(LjackAsyncLane* lane)
+{
+    ljack_client_async_stop(lane);
+    if (lane->semaphoreInitialized) {
+        async_semaphore_destruct(&lane->semaphore);
+    }
+    free(lane->buffers);
+    free(atomic_get_ptr(&lane->spareBuffers));
+    free(atomic_get_ptr(&lane->retiredBuffers));
+    free(lane->slotFrames);
+    free(lane->slotJob);
+    free(lane->slotDone);
+    free(lane->slotBusy);
+    free(lane->connectors);
+    free(lane);
+}
+
+/* ============================================================================================ */
+
+bool ljack_client_async_reserve(LjackAsyncLane* lane, jack_nframes_t nframes)
+{
+    AsyncBuffers* spare = atomic_get_ptr(&lane->spareBuffers);
+    if (nframes <= lane->buffers->capacity || (spare && nframes <= spare->capacity)) {
+        return true;
+    }
+    spare = allocBuffers(lane, nframes);
+    if (!spare) {
+        return false;
+    }
+    /* the process thread may have taken the previous spare buffers in the meantime */
+    free(atomic_set_ptr(&lane->spareBuffers, spare));
+    return true;
+}
+
+bool ljack_client_async_resize(LjackAsyncLane* lane)
+{
+    if (!atomic_get_ptr(&lane->spareBuffers) || atomic_get_ptr(&lane->retiredBuffers)) {
+        return false;
+    }
+    /* the worker thread only accesses the buffers while holding a slot */
+    int held = 0;
+    while (held < lane->slotCount && atomic_set_if_equal(&lane->slotBusy[held], 0, 2)) {
+        ++held;
+    }
+    AsyncBuffers* spare = NULL;
+    if (held == lane->slotCount) {
+        spare = atomic_set_ptr(&lane->spareBuffers, NULL);
+        if (spare) {
+            atomic_set_ptr(&lane->retiredBuffers, lane->buffers);
+            lane->buffers = spare;
+            for (int slot = 0; slot < lane->slotCount; ++slot) {
+                /* outputs that were produced in the replaced buffers are not used */
+                atomic_set(&lane->slotDone[slot], 0);
+            }
+        }
+    }
+    while (held > 0) {
+        atomic_set(&lane->slotBusy[--held], 0);
+    }
+    return spare != NULL;
+}
+
+void ljack_client_async_free_retired(LjackAsyncLane* lane)
+{
+    free(atomic_set_ptr(&lane->retiredBuffers, NULL));
+}
+
+/* ============================================================================================ */
+
+LjackAsyncConnector* ljack_client_async_get_connector(LjackAsyncLane* lane, int index)
+{
+    return lane->connectors + index;
+}
+
+float* ljack_client_async_get_audio_buffer(LjackAsyncConnector* connector)
+{
+    LjackAsyncLane* lane = connector->lane;
+    return slotBuffer(lane, lane->workerSlot, connector->index);
+}
+
+/* ============================================================================================ */
+
+int ljack_client_async_run(LjackAsyncLane* lane, jack_nframes_t nframes)
+{
+    int rc = atomic_get(&lane->errorRc);
+    if (rc != 0) {
+        return rc;
+    }
+    LjackProcReg* reg = lane->reg;
+    if (++lane->cycle == 0) {
+        lane->cycle = 1;
+    }
+    int cycle = lane->cycle;
+    if (lane->activeCycles <= lane->delay) {
+        lane->activeCycles += 1;
+    }
+
+    /* outputs of the cycle that was delay periods ago */
+    int  outCycle = cycle - lane->delay;
+    int  outSlot  = slotOf(lane, outCycle);
+    bool ready    =    atomic_get(&lane->slotDone[outSlot]) == outCycle
+                    && lane->slotFrames[outSlot] == nframes;
+    if (!ready && lane->activeCycles > lane->delay) {
+        atomic_inc(&lane->missed);
+    }
+    for (int i = 0; i < lane->connectorCount; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isOutput) {
+            float* b = ljack_client_intern_get_audio_buffer(info, nframes);
+            if (ready) {
+                memcpy(b, slotBuffer(lane, outSlot, i), nframes * sizeof(float));
+            } else {
+                memset(b, 0, nframes * sizeof(float));
+            }
+        }
+    }
+
+    /* inputs of this cycle, the slot is skipped if the worker is still busy with it */
+    if (nframes > lane->buffers->capacity) {
+        ljack_client_async_resize(lane);
+    }
+    int inSlot = slotOf(lane, cycle);
+    if (nframes <= lane->buffers->capacity && atomic_set_if_equal(&lane->slotBusy[inSlot], 0, 2)) {
+        for (int i = 0; i < lane->connectorCount; ++i) {
+            LjackConnectorInfo* info = reg->connectorInfos + i;
+            if (info->isInput) {
+                float* b = ljack_client_intern_get_audio_buffer(info, nframes);
+                memcpy(slotBuffer(lane, inSlot, i), b, nframes * sizeof(float));
+            }
+        }
+        lane->slotFrames[inSlot] = nframes;
+        atomic_set(&lane->slotJob[inSlot], cycle);
+        atomic_set(&lane->slotBusy[inSlot], 0);
+        atomic_set(&lane->submitted, cycle);
+        async_semaphore_post(&lane->semaphore);
+    }
+    return 0;
+}
+
+void ljack_client_async_reset(LjackAsyncLane* lane)
+{
+    if (lane->activeCycles > 0) {
+        /* outputs that were produced before deactivation are not used */
+        lane->cycle       += lane->slotCount;
+        lane->activeCycles = 0;
+    }
+}
+
+/* ============================================================================================ */
+
+int ljack_client_async_get_delay(LjackAsyncLane* lane)
+{
+    return lane->delay;
+}
+
+int ljack_client_async_get_missed(LjackAsyncLane* lane)
+{
+    return atomic_get(&lane->missed);
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,91 @@
+#ifndef LJACK_CLIENT_ASYNC_H
+#define LJACK_CLIENT_ASYNC_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Asynchronous lane for a processor that is invoked in a non realtime thread of
+ * its own. In every process cycle the JACK process thread copies the inputs
+ * into a slot of preallocated buffers, takes the outputs that were produced for
+ * the cycle that was delay periods ago and wakes the worker thread. The process
+ * thread never waits for the worker thread: if the outputs are not ready in time,
+ * they are silent and a counter of missed cycles is incremented.
+ */
+
+#define LJACK_MAX_ASYNC_DELAY 2
+
+typedef struct LjackClientUserData  LjackClientUserData;
+typedef struct LjackProcReg         LjackProcReg;
+typedef struct LjackAsyncLane       LjackAsyncLane;
+typedef struct LjackAsyncConnector  LjackAsyncConnector;
+
+struct LjackAsyncConnector
+{
+    LjackAsyncLane*  lane;
+    int              index;
+};
+
+/**
+ * Creates the buffers for the current maximum buffer size of the client and
+ * starts the worker thread. Returns NULL on failure.
+ */
+LjackAsyncLane* ljack_client_async_start(LjackClientUserData* udata, LjackProcReg* reg, int delay);
+
+/**
+ * Stops the worker thread. After this function returns, the processor is no longer
+ * invoked. May be called more than once and while the JACK process thread is still
+ * using the lane.
+ */
+void ljack_client_async_stop(LjackAsyncLane* lane);
+
+void ljack_client_async_free(LjackAsyncLane* lane);
+
+/**
+ * Preallocates larger buffers if the lane's buffers are too small for the given
+ * buffer size. The buffers in use are not modified. Is called with locked
+ * processMutex in the Lua thread or in the JACK buffer size callback.
+ */
+bool ljack_client_async_reserve(LjackAsyncLane* lane, jack_nframes_t nframes);
+
+/**
+ * Exchanges the buffers with the buffers prepared by ljack_client_async_reserve()
+ * if the worker thread is not processing. Does not allocate memory, i.e. may
+ * be called in the JACK process thread. Returns true if the buffers were exchanged.
+ */
+bool ljack_client_async_resize(LjackAsyncLane* lane);
+
+/**
+ * Frees buffers that were replaced by ljack_client_async_resize().
+ */
+void ljack_client_async_free_retired(LjackAsyncLane* lane);
+
+LjackAsyncConnector* ljack_client_async_get_connector(LjackAsyncLane* lane, int index);
+
+/**
+ * Gives the buffer of the connector for the cycle that is processed by the
+ * worker thread. Is called in the worker thread.
+ */
+float* ljack_client_async_get_audio_buffer(LjackAsyncConnector* connector);
+
+/**
+ * Is called in the JACK process thread for an activated processor. Returns 0 or the
+ * error code of a failed invocation of the processor in the worker thread.
+ */
+int ljack_client_async_run(LjackAsyncLane* lane, jack_nframes_t nframes);
+
+/**
+ * Is called in the JACK process thread for a deactivated processor.
+ */
+void ljack_client_async_reset(LjackAsyncLane* lane);
+
+int ljack_client_async_get_delay(LjackAsyncLane* lane);
+
+int ljack_client_async_get_missed(LjackAsyncLane* lane);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_ASYNC_H */
@@ -0,0 +1,328 @@
+#include <jack/jack.h>
+#include <jack/thread.h>
+
+#include "util.h"
+#include "error.h"
+#include "receiver_capi.h"
+#include "status_codes.h"
+
+#include "client_intern.h"
+#include "client_coalescer.h"
+#include "main.h"
+
+/* ============================================================================================ */
+
+#define INITIAL_CAPACITY 64
+
+struct LjackClientCoalescer
+{
+    LjackClientUserData*  udata;
+    receiver_writer*      writer;          /* own writer, the helper thread runs concurrently
+                                              to the JACK client callbacks */
+    uint64_t              windowNanos;
+    uint64_t              intervalNanos;   /* minimal time between two deliveries */
+
+    Mutex                 mutex;           /* guards all following fields */
+    bool                  graphOrder;
+
+    jack_port_id_t*       regPorts;
+    unsigned char*        regFlags;
+    int                   regCount;
+    int                   regCapacity;
+
+    jack_port_id_t*       conPorts1;
+    jack_port_id_t*       conPorts2;
+    unsigned char*        conFlags;
+    int                   conCount;
+    int                   conCapacity;
+
+    bool                  pending;
+    uint64_t              firstPending;    /* time of the first pending notification */
+    uint64_t              lastDelivery;
+
+    bool                  started;
+    bool                  stopped;
+    bool                  shouldTerminate;
+    jack_native_thread_t  thread;
+};
+
+/* ============================================================================================ */
+
+static void handleReceiverError(void* ehdata, const char* msg, size_t msglen)
+{
+    ljack_handle_error((error_handler_data*)ehdata, msg, msglen);
+}
+
+static void addMsgToReceiver(LjackClientCoalescer* c)
+{
+    LjackClientUserData* udata  = c->udata;
+    error_handler_data   ehdata = {0};
+    udata->receiver_capi->msgToReceiver(udata->receiver, c->writer,
+                                        false, false, handleReceiverError, &ehdata);
+    if (ehdata.buffer) {
+        ljack_log_error("LJACK: Error while calling client callback.");
+        ljack_log_error("%s", ehdata.buffer);
+        free(ehdata.buffer);
+    }
+}
+
+static void addStatusToWriter(LjackClientCoalescer* c, LjackStatusCode code)
+{
+    ljack_status_add_type(c->udata->receiver_capi, c->writer, c->udata->compactStatus, code);
+}
+
+static void addPortsToWriter(LjackClientCoalescer* c, const jack_port_id_t* ports, int count)
+{
+    unsigned int* a = c->udata->receiver_capi->addArrayToWriter(c->writer, RECEIVER_UINT, count);
+    if (a) {
+        for (int i = 0; i < count; ++i) {
+            a[i] = ports[i];
+        }
+    }
+}
+
+static void addFlagsToWriter(LjackClientCoalescer* c, const unsigned char* flags, int count)
+{
+    unsigned char* a = c->udata->receiver_capi->addArrayToWriter(c->writer, RECEIVER_UCHAR, count);
+    if (a) {
+        memcpy(a, flags, count);
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Registrations are delivered before connections, because connections may refer
+ * to ports that were registered in the same window.
+ */
+static void deliver_LOCKED(LjackClientCoalescer* c)
+{
+    if (c->regCount > 0) {
+        addStatusToWriter(c, LJACK_STATUS_PORT_REGISTRATIONS);
+        addPortsToWriter (c, c->regPorts, c->regCount);
+        addFlagsToWriter (c, c->regFlags, c->regCount);
+        addMsgToReceiver (c);
+        c->regCount = 0;
+    }
+    if (c->conCount > 0) {
+        addStatusToWriter(c, LJACK_STATUS_PORT_CONNECTS);
+        addPortsToWriter (c, c->conPorts1, c->conCount);
+        addPortsToWriter (c, c->conPorts2, c->conCount);
+        addFlagsToWriter (c, c->conFlags,  c->conCount);
+        addMsgToReceiver (c);
+        c->conCount = 0;
+    }
+    if (c->graphOrder) {
+        addStatusToWriter(c, LJACK_STATUS_GRAPH_ORDER);
+        addMsgToReceiver (c);
+        c->graphOrder = false;
+    }
+    c->pending      = false;
+    c->lastDelivery = async_clock_nanos();
+}
+
+static void added_LOCKED(LjackClientCoalescer* c)
+{
+    if (c->stopped) {
+        deliver_LOCKED(c);
+    }
+    else if (!c->pending) {
+        c->pending      = true;
+        c->firstPending = async_clock_nanos();
+        async_mutex_notify(&c->mutex);
+    }
+}
+
+/* ============================================================================================ */
+
+static void* coalescerThread(void* arg)
+{
+    LjackClientCoalescer* c = arg;
+    async_mutex_lock(&c->mutex);
+    while (!c->shouldTerminate) {
+        if (!c->pending) {
+            async_mutex_wait(&c->mutex);
+            continue;
+        }
+        uint64_t due = c->firstPending + c->windowNanos;
+        if (c->lastDelivery + c->intervalNanos > due) {
+            due = c->lastDelivery + c->intervalNanos;
+        }
+        uint64_t now = async_clock_nanos();
+        if (now < due) {
+            async_mutex_wait_millis(&c->mutex, (int)((due - now) / 1000000) + 1);
+            continue;
+        }
+        deliver_LOCKED(c);
+    }
+    async_mutex_unlock(&c->mutex);
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+LjackClientCoalescer* ljack_client_coalescer_start(LjackClientUserData* udata, int windowMillis, int maxRate)
+{
+    LjackClientCoalescer* c = calloc(1, sizeof(LjackClientCoalescer));
+    if (!c) {
+        return NULL;
+    }
+    c->udata         = udata;
+    c->windowNanos   = (uint64_t)windowMillis * 1000000;
+    c->intervalNanos = (maxRate > 0) ? 1000000000 / maxRate : 0;
+    c->writer        = udata->receiver_capi->newWriter(1024, 2);
+    c->regCapacity   = INITIAL_CAPACITY;
+    c->regPorts      = malloc(INITIAL_CAPACITY * sizeof(jack_port_id_t));
+    c->regFlags      = malloc(INITIAL_CAPACITY);
+    c->conCapacity   = INITIAL_CAPACITY;
+    c->conPorts1     = malloc(INITIAL_CAPACITY * sizeof(jack_port_id_t));
+    c->conPorts2     = malloc(INITIAL_CAPACITY * sizeof(jack_port_id_t));
+    c->conFlags      = malloc(INITIAL_CAPACITY);
+    async_mutex_init(&c->mutex);
+    if (!c->writer || !c->regPorts || !c->regFlags || !c->conPorts1 || !c->conPorts2 || !c->conFlags) {
+        ljack_client_coalescer_free(c);
+        return NULL;
+    }
+    int rc = jack_client_create_thread(udata->client, &c->thread, 0, false, coalescerThread, c);
+    if (rc != 0) {
+        ljack_log_error("LJACK: cannot create status coalescing thread (error %d).", rc);
+        ljack_client_coalescer_free(c);
+        return NULL;
+    }
+    c->started = true;
+    return c;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_coalescer_stop(LjackClientCoalescer* c)
+{
+    if (c->started) {
+        async_mutex_lock(&c->mutex);
+        c->shouldTerminate = true;
+        async_mutex_notify(&c->mutex);
+        async_mutex_unlock(&c->mutex);
+
+        jack_client_stop_thread(c->udata->client, c->thread);
+        c->started = false;
+    }
+    async_mutex_lock(&c->mutex);
+    c->stopped = true;
+    deliver_LOCKED(c);
+    async_mutex_unlock(&c->mutex);
+}
+
+void ljack_client_coalescer_free(LjackClientCoalescer* c)
+{
+    if (c->started) {
+        ljack_client_coalescer_stop(c);
+    }
+    if (c->writer) {
+        c->udata->receiver_capi->freeWriter(c->writer);
+    }
+    async_mutex_destruct(&c->mutex);
+    free(c->regPorts);
+    free(c->regFlags);
+    free(c->conPorts1);
+    free(c->conPorts2);
+    free(c->conFlags);
+    free(c);
+}
+
+/* ============================================================================================ */
+
+void ljack_client_coalescer_graph_order(LjackClientCoalescer* c)
+{
+    async_mutex_lock(&c->mutex);
+    c->graphOrder = true;
+    added_LOCKED(c);
+    async_mutex_unlock(&c->mutex);
+}
+
+/* ============================================================================================ */
+
+static bool growRegistrations_LOCKED(LjackClientCoalescer* c)
+{
+    int            newCapacity = 2 * c->regCapacity;
+    jack_port_id_t* ports      = realloc(c->regPorts, newCapacity * sizeof(jack_port_id_t));
+    if (ports) {
+        c->regPorts = ports;
+    }
+    unsigned char*  flags      = realloc(c->regFlags, newCapacity);
+    if (flags) {
+        c->regFlags = flags;
+    }
+    if (ports && flags) {
+        c->regCapacity = newCapacity;
+        return true;
+    }
+    return false;
+}
+
+void ljack_client_coalescer_port_registration(LjackClientCoalescer* c, jack_port_id_t port,
+                                              int registered)
+{
+    async_mutex_lock(&c->mutex);
+    if (c->regCount == c->regCapacity && !growRegistrations_LOCKED(c)) {
+        /* out of memory: deliver what was collected so far */
+        deliver_LOCKED(c);
+    }
+    c->regPorts[c->regCount] = port;
+    c->regFlags[c->regCount] = registered ? 1 : 0;
+    c->regCount += 1;
+    added_LOCKED(c);
+    async_mutex_unlock(&c->mutex);
+}
+
+/* ============================================================================================ */
+
+static bool growConnections_LOCKED(LjackClientCoalescer* c)
+{
+    int             newCapacity = 2 * c->conCapacity;
+    jack_port_id_t* ports1      = realloc(c->conPorts1, newCapacity * sizeof(jack_port_id_t));
+    if (ports1) {
+        c->conPorts1 = ports1;
+    }
+    jack_port_id_t* ports2      = realloc(c->conPorts2, newCapacity * sizeof(jack_port_id_t));
+    if (ports2) {
+        c->conPorts2 = ports2;
+    }
+    unsigned char*  flags       = realloc(c->conFlags, newCapacity);
+    if (flags) {
+        c->conFlags = flags;
+    }
+    if (ports1 && ports2 && flags) {
+        c->conCapacity = newCapacity;
+        return true;
+    }
+    return false;
+}
+
+void ljack_client_coalescer_port_connect(LjackClientCoalescer* c, jack_port_id_t a,
+                                         jack_port_id_t b, int connected)
+{
+    async_mutex_lock(&c->mutex);
+    if (c->conCount == c->conCapacity && !growConnections_LOCKED(c)) {
+        /* out of memory: deliver what was collected so far */
+        deliver_LOCKED(c);
+    }
+    c->conPorts1[c->conCount] = a;
+    c->conPorts2[c->conCount] = b;
+    c->conFlags [c->conCount] = connected ? 1 : 0;
+    c->conCount += 1;
+    added_LOCKED(c);
+    async_mutex_unlock(&c->mutex);
+}
+
+/* ============================================================================================ */
+
+void ljack_client_coalescer_flush(LjackClientCoalescer* c)
+{
+    async_mutex_lock(&c->mutex);
+    if (c->pending) {
+        deliver_LOCKED(c);
+    }
+    async_mutex_unlock(&c->mutex);
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,56 @@
+#ifndef LJACK_CLIENT_COALESCER_H
+#define LJACK_CLIENT_COALESCER_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Collects GraphOrder, PortRegistration and PortConnect notifications of the
+ * JACK client callbacks and delivers them to the status receiver of the client
+ * as aggregated messages from a non-realtime helper thread. Notifications are
+ * collected for windowMillis after the first pending notification and
+ * aggregated messages are delivered at most maxRate times per second.
+ */
+
+#define LJACK_MAX_COALESCING_WINDOW 10000
+#define LJACK_MAX_STATUS_RATE       1000
+
+typedef struct LjackClientUserData   LjackClientUserData;
+typedef struct LjackClientCoalescer  LjackClientCoalescer;
+
+/**
+ * Returns NULL on failure. A maxRate of 0 means that the rate is not limited.
+ */
+LjackClientCoalescer* ljack_client_coalescer_start(LjackClientUserData* udata, int windowMillis, int maxRate);
+
+/**
+ * Delivers all pending notifications and stops the helper thread. Notifications
+ * that are added afterwards are delivered immediately.
+ */
+void ljack_client_coalescer_stop(LjackClientCoalescer* coalescer);
+
+void ljack_client_coalescer_free(LjackClientCoalescer* coalescer);
+
+/**
+ * The following functions are called from the JACK client callbacks.
+ */
+void ljack_client_coalescer_graph_order(LjackClientCoalescer* coalescer);
+
+void ljack_client_coalescer_port_registration(LjackClientCoalescer* coalescer, jack_port_id_t port,
+                                              int registered);
+
+void ljack_client_coalescer_port_connect(LjackClientCoalescer* coalescer, jack_port_id_t a,
+                                         jack_port_id_t b, int connected);
+
+/**
+ * Delivers all pending notifications. Is called before status messages are sent
+ * that refer to ports of earlier notifications.
+ */
+void ljack_client_coalescer_flush(LjackClientCoalescer* coalescer);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_COALESCER_H */
@@ -0,0 +1,555 @@
+/* async_defines.h must be included first */
+#include "async_defines.h"
+
+#if defined(LJACK_ASYNC_USE_WIN32)
+    #include <malloc.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <jack/jack.h>
+#include <jack/thread.h>
+
+#include "util.h"
+#include "error.h"
+#include "receiver_capi.h"
+#include "status_codes.h"
+
+#include "client_intern.h"
+#include "client_events.h"
+#include "main.h"
+
+/* ============================================================================================ */
+
+#define LJACK_EVENT_QUEUE_LENGTH 64    /* must be a power of 2 */
+
+/**
+ * Bounded multi-producer queue: a producer claims a slot by incrementing 
+ * enqueuePos and publishes the event by setting the slot's sequence. Producers
+ * never wait for each other, a producer that is preempted after claiming a slot
+ * only delays the helper thread.
+ */
+typedef struct EventSlot
+{
+    AtomicCounter  sequence;
+    LjackEvent     event;
+} EventSlot;
+
+struct LjackClientEvents
+{
+    LjackClientUserData*  udata;
+    receiver_writer*      writer;         /* own writer, the helper thread runs concurrently
+                                             to the JACK client callbacks */
+    EventSlot*            slots;
+    AtomicCounter         enqueuePos;
+    int                   dequeuePos;     /* only used by the helper thread */
+    AtomicCounter         droppedCounter;
+    
+    Semaphore             wakeup;
+    AtomicCounter         shouldTerminate;
+    jack_native_thread_t  thread;
+};
+
+/* ============================================================================================ */
+
+static void addStatusToWriter(LjackClientEvents* events, LjackStatusCode code)
+{
+    LjackClientUserData* udata = events->udata;
+    ljack_status_add_type(udata->receiver_capi, events->writer, udata->compactStatus, code);
+}
+
+static void addStringToWriter(LjackClientEvents* events, const char* str)
+{
+    events->udata->receiver_capi->addStringToWriter(events->writer, str, strlen(str));
+}
+
+static void addIntegerToWriter(LjackClientEvents* events, lua_Integer i)
+{
+    events->udata->receiver_capi->addIntegerToWriter(events->writer, i);
+}
+
+static void handleReceiverError(void* ehdata, const char* msg, size_t msglen)
+{
+    ljack_handle_error((error_handler_data*)ehdata, msg, msglen);
+}
+
+static void addMsgToReceiver(LjackClientEvents* events)
+{
+    LjackClientUserData* udata  = events->udata;
+    error_handler_data   ehdata = {0};
+    udata->receiver_capi->msgToReceiver(udata->receiver, events->writer, 
+                                        false, false, handleReceiverError, &ehdata);
+    if (ehdata.buffer) {
+        ljack_log_error("LJACK: Error while calling client callback.");
+        ljack_log_error("%s", ehdata.buffer);
+        free(ehdata.buffer);
+    }
+}
+
+/* ============================================================================================ */
+
+typedef enum LengthModifier
+{
+    LENGTH_NONE, LENGTH_HH, LENGTH_H, LENGTH_L, LENGTH_LL, 
+    LENGTH_J,    LENGTH_Z,  LENGTH_T, LENGTH_LONG_DOUBLE
+} LengthModifier;
+
+typedef struct FormatSpec
+{
+    int             length;       /* number of characters including '%' */
+    int             starCount;    /* width or precision given as argument */
+    LengthModifier  modifier;
+    int             modifierPos;  /* position of the length modifier within the spec */
+    int             modifierLength;
+    char            conversion;   /* 0 if the spec is invalid */
+} FormatSpec;
+
+static void parseSpec(const char* s, FormatSpec* spec)
+{
+    int i = 1;
+    spec->starCount = 0;
+    while (s[i] && strchr("-+ #0'", s[i])) {
+        ++i;
+    }
+    if (s[i] == '*') {
+        spec->starCount += 1;
+        ++i;
+    } else {
+        while (s[i] >= '0' && s[i] <= '9') ++i;
+    }
+    if (s[i] == '.') {
+        ++i;
+        if (s[i] == '*') {
+            spec->starCount += 1;
+            ++i;
+        } else {
+            while (s[i] >= '0' && s[i] <= '9') ++i;
+        }
+    }
+    spec->modifierPos = i;
+    switch (s[i]) {
+        case 'h': if (s[i + 1] == 'h') { spec->modifier = LENGTH_HH; i += 2; }
+                  else                 { spec->modifier = LENGTH_H;  i += 1; } break;
+        case 'l': if (s[i + 1] == 'l') { spec->modifier = LENGTH_LL; i += 2; }
+                  else                 { spec->modifier = LENGTH_L;  i += 1; } break;
+        case 'j': spec->modifier = LENGTH_J;           i += 1; break;
+        case 'z': spec->modifier = LENGTH_Z;           i += 1; break;
+        case 't': spec->modifier = LENGTH_T;           i += 1; break;
+        case 'L': spec->modifier = LENGTH_LONG_DOUBLE; i += 1; break;
+        default:  spec->modifier = LENGTH_NONE;                break;
+    }
+    spec->modifierLength = i - spec->modifierPos;
+    spec->conversion     = (s[i] && strchr("diouxXcfFeEgGaAsp%", s[i])) ? s[i] : 0;
+    spec->length         = spec->conversion ? i + 1 : i;
+}
+
+/**
+ * Formats the text of an event that was given by ljack_client_events_pushV.
+ * The integer arguments were widened to long long, the floating point arguments
+ * to double.
+ */
+static void formatEvent(const LjackEvent* event, char* out, size_t size)
+{
+    const char* fmt = event->text;
+    size_t      pos = 0;
+    int         n   = 0;
+    int         i   = 0;
+    while (i < event->fmtEnd && pos + 1 < size) {
+        if (fmt[i] != '%') {
+            out[pos++] = fmt[i++];
+            continue;
+        }
+        FormatSpec spec;
+        parseSpec(fmt + i, &spec);
+        if (spec.conversion == '%') {
+            out[pos++] = '%';
+            i += spec.length;
+            continue;
+        }
+        /* spec with normalized length modifier */
+        char sub[32];
+        int  subLength = spec.modifierPos;
+        if (subLength + 3 >= (int)sizeof(sub)) {
+            break;
+        }
+        memcpy(sub, fmt + i, subLength);
+        if (strchr("dioxXu", spec.conversion)) {
+            sub[subLength++] = 'l';
+            sub[subLength++] = 'l';
+        }
+        sub[subLength++] = spec.conversion;
+        sub[subLength]   = '\0';
+
+        int star[2] = { 0, 0 };
+        for (int k = 0; k < spec.starCount; ++k) {
+            star[k] = (int)event->args[n++].i;
+        }
+        const LjackEventArg* arg  = event->args + n++;
+        char*                dst  = out + pos;
+        size_t               room = size - pos;
+        int                  rc;
+        #define FORMAT_ARG(value) \
+            rc = (spec.starCount == 0) ? snprintf(dst, room, sub, value) \
+               : (spec.starCount == 1) ? snprintf(dst, room, sub, star[0], value) \
+                                       : snprintf(dst, room, sub, star[0], star[1], value)
+        switch (spec.conversion) {
+            case 'd': case 'i': 
+                FORMAT_ARG(arg->i); break;
+            case 'o': case 'u': case 'x': case 'X':
+                FORMAT_ARG(arg->u); break;
+            case 'c':
+                FORMAT_ARG((int)arg->i); break;
+            case 'p':
+                FORMAT_ARG(arg->p); break;
+            case 's':
+                FORMAT_ARG((arg->offset >= 0) ? event->text + arg->offset : ""); break;
+            default:
+                FORMAT_ARG(arg->d); break;
+        }
+        #undef FORMAT_ARG
+        if (rc > 0) {
+            pos += ((size_t)rc < room) ? (size_t)rc : room - 1;
+        }
+        i += spec.length;
+    }
+    if (i < event->fmtLength && pos + 4 < size) {
+        memcpy(out + pos, "...", 3);
+        pos += 3;
+    }
+    out[pos] = '\0';
+}
+
+/* ============================================================================================ */
+
+static void deliverEvent(LjackClientEvents* events, LjackEvent* event)
+{
+    LjackClientUserData* udata = events->udata;
+
+    switch (event->type) {
+        case LJACK_EVENT_PROCESSING_ERROR: {
+            ljack_log_error("LJACK: client invalidated because processor '%s' returned processing error %d.", 
+                            event->text, event->code);
+            async_mutex_lock(&udata->processMutex);
+            {
+                async_mutex_notify(&udata->processMutex);
+                if (events->writer) {
+                    addStatusToWriter (events, LJACK_STATUS_PROCESSING_ERROR);
+                    addStringToWriter (events, "client invalidated because processor returned processing error");
+                    addStringToWriter (events, event->text);
+                    addIntegerToWriter(events, event->code);
+                    addMsgToReceiver  (events);
+                }
+            }
+            async_mutex_unlock(&udata->processMutex);
+            break;
+        }
+        case LJACK_EVENT_LOG_ERROR:
+        case LJACK_EVENT_LOG_INFO: {
+            char        buffer[1024];
+            const char* text = event->text;
+            if (event->fmtLength > 0) {
+                formatEvent(event, buffer, sizeof(buffer));
+                text = buffer;
+            }
+            if (event->type == LJACK_EVENT_LOG_ERROR) {
+                ljack_log_error("%s", text);
+            } else {
+                ljack_log_info("%s", text);
+            }
+            break;
+        }
+    }
+}
+
+static void deliverPendingEvents(LjackClientEvents* events)
+{
+    LjackEvent event;
+    while (true) {
+        int        pos  = events->dequeuePos;
+        EventSlot* slot = events->slots + (unsigned int)pos % LJACK_EVENT_QUEUE_LENGTH;
+        if (atomic_get(&slot->sequence) != (int)((unsigned int)pos + 1)) {
+            /* empty or the producer has not finished writing */
+            break;
+        }
+        memcpy(&event, &slot->event, sizeof(LjackEvent));
+        atomic_set(&slot->sequence, (int)((unsigned int)pos + LJACK_EVENT_QUEUE_LENGTH));
+        events->dequeuePos = (int)((unsigned int)pos + 1);
+        deliverEvent(events, &event);
+    }
+    int dropped = atomic_set(&events->droppedCounter, 0);
+    if (dropped > 0) {
+        ljack_log_error("LJACK: %d events from process thread were dropped.", dropped);
+    }
+}
+
+static void* eventThread(void* arg)
+{
+    LjackClientEvents* events = arg;
+    while (true) {
+        async_semaphore_wait(&events->wakeup);
+        deliverPendingEvents(events);
+        if (atomic_get(&events->shouldTerminate)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+static EventSlot* allocSlots(void)
+{
+    size_t size = LJACK_EVENT_QUEUE_LENGTH * sizeof(EventSlot);
+    EventSlot* slots = calloc(1, size);
+    if (slots) {
+#if defined(LJACK_ASYNC_USE_WIN32)
+        VirtualLock(slots, size);
+#else
+        mlock(slots, size);
+#endif
+        for (int i = 0; i < LJACK_EVENT_QUEUE_LENGTH; ++i) {
+            atomic_set(&slots[i].sequence, i);
+        }
+    }
+    return slots;
+}
+
+static void freeSlots(EventSlot* slots)
+{
+    size_t size = LJACK_EVENT_QUEUE_LENGTH * sizeof(EventSlot);
+#if defined(LJACK_ASYNC_USE_WIN32)
+    VirtualUnlock(slots, size);
+#else
+    munlock(slots, size);
+#endif
+    free(slots);
+}
+
+/* ============================================================================================ */
+
+LjackClientEvents* ljack_client_events_start(LjackClientUserData* udata)
+{
+    LjackClientEvents* events = calloc(1, sizeof(LjackClientEvents));
+    if (!events) {
+        return NULL;
+    }
+    events->udata = udata;
+    events->slots = allocSlots();
+    if (!events->slots) {
+        free(events);
+        return NULL;
+    }
+    if (udata->receiver) {
+        events->writer = udata->receiver_capi->newWriter(1024, 2);
+        if (!events->writer) {
+            freeSlots(events->slots);
+            free(events);
+            return NULL;
+        }
+    }
+    async_semaphore_init(&events->wakeup);
+    
+    int rc = jack_client_create_thread(udata->client, &events->thread, 0, false, 
+                                       eventThread, events);
+    if (rc != 0) {
+        ljack_log_error("LJACK: cannot create event thread (error %d).", rc);
+        async_semaphore_destruct(&events->wakeup);
+        if (events->writer) {
+            udata->receiver_capi->freeWriter(events->writer);
+        }
+        freeSlots(events->slots);
+        free(events);
+        return NULL;
+    }
+    return events;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_events_stop(LjackClientEvents* events)
+{
+    atomic_set(&events->shouldTerminate, 1);
+    async_semaphore_post(&events->wakeup);
+    jack_client_stop_thread(events->udata->client, events->thread);
+
+    async_semaphore_destruct(&events->wakeup);
+    if (events->writer) {
+        events->udata->receiver_capi->freeWriter(events->writer);
+    }
+    freeSlots(events->slots);
+    free(events);
+}
+
+/* ============================================================================================ */
+
+/**
+ * Claims a slot for writing, returns NULL if the queue is full. The event must be 
+ * published by calling publishSlot.
+ */
+static EventSlot* claimSlot(LjackClientEvents* events, int* claimedPos)
+{
+    int pos = atomic_get(&events->enqueuePos);
+    while (true) {
+        EventSlot* slot = events->slots + (unsigned int)pos % LJACK_EVENT_QUEUE_LENGTH;
+        int        diff = (int)((unsigned int)atomic_get(&slot->sequence) - (unsigned int)pos);
+        if (diff == 0) {
+            if (atomic_set_if_equal(&events->enqueuePos, pos, (int)((unsigned int)pos + 1))) {
+                *claimedPos = pos;
+                return slot;
+            }
+            /* another producer claimed the slot, no waiting for it */
+        }
+        else if (diff < 0) {
+            atomic_inc(&events->droppedCounter);
+            return NULL;
+        }
+        pos = atomic_get(&events->enqueuePos);
+    }
+}
+
+static void publishSlot(LjackClientEvents* events, EventSlot* slot, int pos)
+{
+    atomic_set(&slot->sequence, (int)((unsigned int)pos + 1));
+    async_semaphore_post(&events->wakeup);
+}
+
+bool ljack_client_events_push(LjackClientEvents* events, int type, int code, 
+                              const char* text)
+{
+    int        pos;
+    EventSlot* slot = claimSlot(events, &pos);
+    if (!slot) {
+        return false;
+    }
+    LjackEvent* event = &slot->event;
+    event->type      = type;
+    event->code      = code;
+    event->fmtLength = 0;
+    event->fmtEnd    = 0;
+    event->argCount  = 0;
+    if (text) {
+        strncpy(event->text, text, LJACK_EVENT_TEXT_SIZE - 1);
+        event->text[LJACK_EVENT_TEXT_SIZE - 1] = '\0';
+    } else {
+        event->text[0] = '\0';
+    }
+    publishSlot(events, slot, pos);
+    return true;
+}
+
+/**
+ * Copies the arguments for the conversions in event->text, the string arguments
+ * are copied behind the format string.
+ */
+static void collectArgs(LjackEvent* event, va_list args)
+{
+    const char* fmt  = event->text;
+    int         used = event->fmtLength + 1;
+    int         n    = 0;
+    int         i    = 0;
+    while (fmt[i]) {
+        if (fmt[i] != '%') {
+            ++i;
+            continue;
+        }
+        FormatSpec spec;
+        parseSpec(fmt + i, &spec);
+        if (spec.conversion == '%') {
+            i += spec.length;
+            continue;
+        }
+        if (!spec.conversion || n + spec.starCount + 1 > LJACK_EVENT_MAX_ARGS) {
+            break;
+        }
+        for (int k = 0; k < spec.starCount; ++k) {
+            event->args[n++].i = va_arg(args, int);
+        }
+        LjackEventArg* arg = event->args + n++;
+        switch (spec.conversion) {
+            case 'd': case 'i':
+                switch (spec.modifier) {
+                    case LENGTH_HH: arg->i = (signed char)va_arg(args, int); break;
+                    case LENGTH_H:  arg->i = (short)      va_arg(args, int); break;
+                    case LENGTH_L:  arg->i = va_arg(args, long);      break;
+                    case LENGTH_LL: arg->i = va_arg(args, long long); break;
+                    case LENGTH_J:  arg->i = va_arg(args, intmax_t);  break;
+                    case LENGTH_Z:  arg->i = va_arg(args, size_t);    break;
+                    case LENGTH_T:  arg->i = va_arg(args, ptrdiff_t); break;
+                    default:        arg->i = va_arg(args, int);       break;
+                }
+                break;
+            case 'o': case 'u': case 'x': case 'X':
+                switch (spec.modifier) {
+                    case LENGTH_HH: arg->u = (unsigned char)     va_arg(args, unsigned int); break;
+                    case LENGTH_H:  arg->u = (unsigned short)    va_arg(args, unsigned int); break;
+                    case LENGTH_L:  arg->u = va_arg(args, unsigned long);      break;
+                    case LENGTH_LL: arg->u = va_arg(args, unsigned long long); break;
+                    case LENGTH_J:  arg->u = va_arg(args, uintmax_t);          break;
+                    case LENGTH_Z:  arg->u = va_arg(args, size_t);             break;
+                    case LENGTH_T:  arg->u = va_arg(args, ptrdiff_t);          break;
+                    default:        arg->u = va_arg(args, unsigned int);       break;
+                }
+                break;
+            case 'c':
+                arg->i = va_arg(args, int);
+                break;
+            case 'p':
+                arg->p = va_arg(args, const void*);
+                break;
+            case 's': {
+                const char* str = va_arg(args, const char*);
+                if (!str) {
+                    str = "(null)";
+                }
+                int room = LJACK_EVENT_TEXT_SIZE - used;
+                if (room > 0) {
+                    int len = (int)strlen(str);
+                    if (len > room - 1) {
+                        len = room - 1;
+                    }
+                    memcpy(event->text + used, str, len);
+                    event->text[used + len] = '\0';
+                    arg->offset = used;
+                    used += len + 1;
+                } else {
+                    arg->offset = -1;
+                }
+                break;
+            }
+            default:
+                if (spec.modifier == LENGTH_LONG_DOUBLE) {
+                    arg->d = (double)va_arg(args, long double);
+                } else {
+                    arg->d = va_arg(args, double);
+                }
+                break;
+        }
+        i += spec.length;
+    }
+    event->fmtEnd   = i;
+    event->argCount = n;
+}
+
+bool ljack_client_events_pushV(LjackClientEvents* events, int type, int code, 
+                               const char* fmt, va_list args)
+{
+    int        pos;
+    EventSlot* slot = claimSlot(events, &pos);
+    if (!slot) {
+        return false;
+    }
+    LjackEvent* event = &slot->event;
+    event->type = type;
+    event->code = code;
+    strncpy(event->text, fmt, LJACK_EVENT_TEXT_SIZE - 1);
+    event->text[LJACK_EVENT_TEXT_SIZE - 1] = '\0';
+    event->fmtLength = (int)strlen(event->text);
+    collectArgs(event, args);
+    publishSlot(events, slot, pos);
+    return true;
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,76 @@
+#ifndef LJACK_CLIENT_EVENTS_H
+#define LJACK_CLIENT_EVENTS_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Preallocated event queue for passing error and status records from the
+ * realtime threads to a non-realtime helper thread, which delivers them to 
+ * the error log and to the status receiver of the client.
+ */
+
+typedef struct LjackClientUserData LjackClientUserData;
+typedef struct LjackClientEvents   LjackClientEvents;
+
+typedef enum LjackEventType
+{
+    LJACK_EVENT_PROCESSING_ERROR = 1,
+    LJACK_EVENT_LOG_ERROR        = 2,
+    LJACK_EVENT_LOG_INFO         = 3
+    
+} LjackEventType;
+
+#define LJACK_EVENT_TEXT_SIZE 240
+#define LJACK_EVENT_MAX_ARGS  8
+
+typedef union LjackEventArg
+{
+    long long           i;
+    unsigned long long  u;
+    double              d;
+    const void*         p;
+    int                 offset;   /* of a string argument within text, -1 if it did not fit */
+} LjackEventArg;
+
+typedef struct LjackEvent
+{
+    int            type;
+    int            code;
+    int            fmtLength;     /* > 0 if text starts with a format string */
+    int            fmtEnd;        /* arguments were collected up to this position */
+    int            argCount;
+    LjackEventArg  args[LJACK_EVENT_MAX_ARGS];
+    char           text[LJACK_EVENT_TEXT_SIZE]; /* NUL terminated, may be truncated, string
+                                                   arguments follow the format string */
+} LjackEvent;
+
+LjackClientEvents* ljack_client_events_start(LjackClientUserData* udata);
+
+/**
+ * Delivers all pending events and stops the helper thread.
+ */
+void ljack_client_events_stop(LjackClientEvents* events);
+
+/**
+ * May be called from any thread, also from realtime threads. Never blocks, never
+ * waits for other producers and never allocates memory. Returns false if the queue 
+ * was full.
+ */
+bool ljack_client_events_push(LjackClientEvents* events, int type, int code, 
+                              const char* text);
+
+/**
+ * Like ljack_client_events_push, but only copies the format string and the raw
+ * arguments: the text is formatted in the helper thread. At most LJACK_EVENT_MAX_ARGS
+ * arguments are supported, the conversion %n is not supported.
+ */
+bool ljack_client_events_pushV(LjackClientEvents* events, int type, int code, 
+                               const char* fmt, va_list args);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_EVENTS_H */
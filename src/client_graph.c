@@ -0,0 +1,570 @@
+#include <jack/jack.h>
+
+#include "util.h"
+
+#include "client_graph.h"
+
+/* ============================================================================================ */
+
+#define INITIAL_BUCKETS 64
+
+typedef struct GraphPort GraphPort;
+typedef struct GraphEdge GraphEdge;
+
+struct GraphPort
+{
+    jack_port_t* port;
+    char*        name;
+    GraphPort*   nextByName;
+    GraphPort*   nextByPtr;
+    GraphPort**  connected;
+    int          connectedCount;
+    int          connectedCapacity;
+};
+
+struct GraphEdge
+{
+    GraphPort* a;           /* a < b */
+    GraphPort* b;
+    GraphEdge* next;
+};
+
+struct LjackClientGraph
+{
+    jack_client_t* client;
+    Mutex          mutex;
+    bool           valid;
+    lua_Integer    generation;
+
+    size_t         portCount;
+    size_t         portBuckets;
+    GraphPort**    byName;
+    GraphPort**    byPtr;
+
+    size_t         edgeCount;
+    size_t         edgeBuckets;
+    GraphEdge**    edges;
+};
+
+/* ============================================================================================ */
+
+static size_t hashString(const char* s)
+{
+    size_t h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static size_t hashPtr(const void* p)
+{
+    size_t h = (size_t)p;
+    return h ^ (h >> 7) ^ (h >> 17);
+}
+
+static size_t hashEdge(const GraphPort* a, const GraphPort* b)
+{
+    return hashPtr(a) * 31 + hashPtr(b);
+}
+
+/* ============================================================================================ */
+
+static GraphPort* findByName(LjackClientGraph* graph, const char* name)
+{
+    GraphPort* p = graph->byName[hashString(name) & (graph->portBuckets - 1)];
+    while (p && strcmp(p->name, name) != 0) {
+        p = p->nextByName;
+    }
+    return p;
+}
+
+static GraphPort* findByPtr(LjackClientGraph* graph, jack_port_t* port)
+{
+    GraphPort* p = graph->byPtr[hashPtr(port) & (graph->portBuckets - 1)];
+    while (p && p->port != port) {
+        p = p->nextByPtr;
+    }
+    return p;
+}
+
+static GraphEdge** findEdge(LjackClientGraph* graph, GraphPort* a, GraphPort* b)
+{
+    if (a > b) {
+        GraphPort* t = a; a = b; b = t;
+    }
+    GraphEdge** e = &graph->edges[hashEdge(a, b) & (graph->edgeBuckets - 1)];
+    while (*e && ((*e)->a != a || (*e)->b != b)) {
+        e = &(*e)->next;
+    }
+    return e;
+}
+
+static void linkPort(LjackClientGraph* graph, GraphPort* p)
+{
+    size_t i = hashString(p->name) & (graph->portBuckets - 1);
+    size_t j = hashPtr(p->port)    & (graph->portBuckets - 1);
+    p->nextByName = graph->byName[i];
+    p->nextByPtr  = graph->byPtr[j];
+    graph->byName[i] = p;
+    graph->byPtr[j]  = p;
+}
+
+static void unlinkByName(LjackClientGraph* graph, GraphPort* p)
+{
+    GraphPort** q = &graph->byName[hashString(p->name) & (graph->portBuckets - 1)];
+    while (*q != p) {
+        q = &(*q)->nextByName;
+    }
+    *q = p->nextByName;
+}
+
+static void unlinkByPtr(LjackClientGraph* graph, GraphPort* p)
+{
+    GraphPort** q = &graph->byPtr[hashPtr(p->port) & (graph->portBuckets - 1)];
+    while (*q != p) {
+        q = &(*q)->nextByPtr;
+    }
+    *q = p->nextByPtr;
+}
+
+/* ============================================================================================ */
+
+static bool growPorts(LjackClientGraph* graph)
+{
+    size_t      n      = graph->portBuckets * 2;
+    GraphPort** byName = calloc(n, sizeof(GraphPort*));
+    GraphPort** byPtr  = calloc(n, sizeof(GraphPort*));
+    if (!byName || !byPtr) {
+        free(byName);
+        free(byPtr);
+        return false;
+    }
+    GraphPort** oldByName = graph->byName;
+    size_t      oldN      = graph->portBuckets;
+    free(graph->byPtr);
+    graph->byName      = byName;
+    graph->byPtr       = byPtr;
+    graph->portBuckets = n;
+    for (size_t i = 0; i < oldN; ++i) {
+        GraphPort* p = oldByName[i];
+        while (p) {
+            GraphPort* next = p->nextByName;
+            linkPort(graph, p);
+            p = next;
+        }
+    }
+    free(oldByName);
+    return true;
+}
+
+static bool growEdges(LjackClientGraph* graph)
+{
+    size_t      n     = graph->edgeBuckets * 2;
+    GraphEdge** edges = calloc(n, sizeof(GraphEdge*));
+    if (!edges) {
+        return false;
+    }
+    GraphEdge** oldEdges = graph->edges;
+    size_t      oldN     = graph->edgeBuckets;
+    graph->edges       = edges;
+    graph->edgeBuckets = n;
+    for (size_t i = 0; i < oldN; ++i) {
+        GraphEdge* e = oldEdges[i];
+        while (e) {
+            GraphEdge* next = e->next;
+            size_t     j    = hashEdge(e->a, e->b) & (n - 1);
+            e->next  = edges[j];
+            edges[j] = e;
+            e = next;
+        }
+    }
+    free(oldEdges);
+    return true;
+}
+
+/* ============================================================================================ */
+
+static GraphPort* addPort(LjackClientGraph* graph, jack_port_t* port)
+{
+    GraphPort* p = findByPtr(graph, port);
+    if (p) {
+        return p;
+    }
+    const char* name = jack_port_name(port);
+    if (!name) {
+        return NULL;
+    }
+    if (graph->portCount >= graph->portBuckets && !growPorts(graph)) {
+        return NULL;
+    }
+    p = calloc(1, sizeof(GraphPort));
+    if (!p) {
+        return NULL;
+    }
+    p->port = port;
+    p->name = malloc(strlen(name) + 1);
+    if (!p->name) {
+        free(p);
+        return NULL;
+    }
+    strcpy(p->name, name);
+    linkPort(graph, p);
+    graph->portCount += 1;
+    return p;
+}
+
+static bool addConnected(GraphPort* p, GraphPort* q)
+{
+    if (p->connectedCount >= p->connectedCapacity) {
+        int         n = p->connectedCapacity ? 2 * p->connectedCapacity : 4;
+        GraphPort** c = realloc(p->connected, n * sizeof(GraphPort*));
+        if (!c) {
+            return false;
+        }
+        p->connected         = c;
+        p->connectedCapacity = n;
+    }
+    p->connected[p->connectedCount++] = q;
+    return true;
+}
+
+static void removeConnected(GraphPort* p, GraphPort* q)
+{
+    for (int i = 0; i < p->connectedCount; ++i) {
+        if (p->connected[i] == q) {
+            memmove(p->connected + i, p->connected + i + 1, (p->connectedCount - i - 1) * sizeof(GraphPort*));
+            p->connectedCount -= 1;
+            return;
+        }
+    }
+}
+
+static bool addEdge(LjackClientGraph* graph, GraphPort* a, GraphPort* b)
+{
+    if (*findEdge(graph, a, b)) {
+        return true;
+    }
+    if (graph->edgeCount >= graph->edgeBuckets && !growEdges(graph)) {
+        return false;
+    }
+    GraphEdge* e = malloc(sizeof(GraphEdge));
+    if (!e) {
+        return false;
+    }
+    if (!addConnected(a, b)) {
+        free(e);
+        return false;
+    }
+    if (!addConnected(b, a)) {
+        removeConnected(a, b);
+        free(e);
+        return false;
+    }
+    e->a    = (a < b) ? a : b;
+    e->b    = (a < b) ? b : a;
+    GraphEdge** head = &graph->edges[hashEdge(e->a, e->b) & (graph->edgeBuckets - 1)];
+    e->next = *head;
+    *head   = e;
+    graph->edgeCount += 1;
+    return true;
+}
+
+static void removeEdge(LjackClientGraph* graph, GraphPort* a, GraphPort* b)
+{
+    GraphEdge** e = findEdge(graph, a, b);
+    if (*e) {
+        GraphEdge* found = *e;
+        *e = found->next;
+        free(found);
+        graph->edgeCount -= 1;
+        removeConnected(a, b);
+        removeConnected(b, a);
+    }
+}
+
+static void removePort(LjackClientGraph* graph, GraphPort* p)
+{
+    while (p->connectedCount > 0) {
+        removeEdge(graph, p, p->connected[p->connectedCount - 1]);
+    }
+    unlinkByName(graph, p);
+    unlinkByPtr(graph, p);
+    graph->portCount -= 1;
+    free(p->connected);
+    free(p->name);
+    free(p);
+}
+
+static void clearGraph(LjackClientGraph* graph)
+{
+    for (size_t i = 0; i < graph->edgeBuckets; ++i) {
+        GraphEdge* e = graph->edges[i];
+        while (e) {
+            GraphEdge* next = e->next;
+            free(e);
+            e = next;
+        }
+        graph->edges[i] = NULL;
+    }
+    for (size_t i = 0; i < graph->portBuckets; ++i) {
+        GraphPort* p = graph->byName[i];
+        while (p) {
+            GraphPort* next = p->nextByName;
+            free(p->connected);
+            free(p->name);
+            free(p);
+            p = next;
+        }
+        graph->byName[i] = NULL;
+        graph->byPtr[i]  = NULL;
+    }
+    graph->portCount = 0;
+    graph->edgeCount = 0;
+}
+
+/* ============================================================================================ */
+
+static bool seed_LOCKED(LjackClientGraph* graph)
+{
+    clearGraph(graph);
+    graph->generation += 1;
+
+    const char** ports = jack_get_ports(graph->client, NULL, NULL, 0);
+    if (!ports) {
+        graph->valid = true;
+        return true;
+    }
+    bool ok = true;
+    for (int i = 0; ok && ports[i]; ++i) {
+        jack_port_t* port = jack_port_by_name(graph->client, ports[i]);
+        if (port && !addPort(graph, port)) {
+            ok = false;
+        }
+    }
+    for (int i = 0; ok && ports[i]; ++i) {
+        GraphPort* p = findByName(graph, ports[i]);
+        if (p && (jack_port_flags(p->port) & JackPortIsOutput)) {
+            const char** cons = jack_port_get_all_connections(graph->client, p->port);
+            if (cons) {
+                for (int j = 0; ok && cons[j]; ++j) {
+                    GraphPort* q = findByName(graph, cons[j]);
+                    if (q && !addEdge(graph, p, q)) {
+                        ok = false;
+                    }
+                }
+                jack_free(cons);
+            }
+        }
+    }
+    jack_free(ports);
+    if (!ok) {
+        clearGraph(graph);
+    }
+    graph->valid = ok;
+    return ok;
+}
+
+static bool prepare_LOCKED(LjackClientGraph* graph, bool activated)
+{
+    if (graph->valid && activated) {
+        return true;
+    }
+    return seed_LOCKED(graph);
+}
+
+/* ============================================================================================ */
+
+LjackClientGraph* ljack_client_graph_new(jack_client_t* client)
+{
+    LjackClientGraph* graph = calloc(1, sizeof(LjackClientGraph));
+    if (!graph) {
+        return NULL;
+    }
+    graph->client      = client;
+    graph->portBuckets = INITIAL_BUCKETS;
+    graph->edgeBuckets = INITIAL_BUCKETS;
+    graph->byName      = calloc(INITIAL_BUCKETS, sizeof(GraphPort*));
+    graph->byPtr       = calloc(INITIAL_BUCKETS, sizeof(GraphPort*));
+    graph->edges       = calloc(INITIAL_BUCKETS, sizeof(GraphEdge*));
+    if (!graph->byName || !graph->byPtr || !graph->edges) {
+        free(graph->byName);
+        free(graph->byPtr);
+        free(graph->edges);
+        free(graph);
+        return NULL;
+    }
+    async_mutex_init(&graph->mutex);
+    return graph;
+}
+
+void ljack_client_graph_free(LjackClientGraph* graph)
+{
+    clearGraph(graph);
+    free(graph->byName);
+    free(graph->byPtr);
+    free(graph->edges);
+    async_mutex_destruct(&graph->mutex);
+    free(graph);
+}
+
+void ljack_client_graph_invalidate(LjackClientGraph* graph)
+{
+    async_mutex_lock(&graph->mutex);
+    {
+        graph->valid = false;
+    }
+    async_mutex_unlock(&graph->mutex);
+}
+
+/* ============================================================================================ */
+
+void ljack_client_graph_port_registered(LjackClientGraph* graph, jack_port_id_t id, int registered)
+{
+    async_mutex_lock(&graph->mutex);
+    if (graph->valid) {
+        jack_port_t* port = jack_port_by_id(graph->client, id);
+        if (port) {
+            if (registered) {
+                if (!addPort(graph, port)) {
+                    graph->valid = false;
+                }
+            } else {
+                GraphPort* p = findByPtr(graph, port);
+                if (p) {
+                    removePort(graph, p);
+                }
+            }
+            graph->generation += 1;
+        }
+    }
+    async_mutex_unlock(&graph->mutex);
+}
+
+void ljack_client_graph_port_connected(LjackClientGraph* graph, jack_port_id_t a, jack_port_id_t b,
+                                       int connected)
+{
+    async_mutex_lock(&graph->mutex);
+    if (graph->valid) {
+        jack_port_t* portA = jack_port_by_id(graph->client, a);
+        jack_port_t* portB = jack_port_by_id(graph->client, b);
+        if (portA && portB) {
+            if (connected) {
+                GraphPort* p = addPort(graph, portA);
+                GraphPort* q = p ? addPort(graph, portB) : NULL;
+                if (!q || !addEdge(graph, p, q)) {
+                    graph->valid = false;
+                }
+            } else {
+                GraphPort* p = findByPtr(graph, portA);
+                GraphPort* q = findByPtr(graph, portB);
+                if (p && q) {
+                    removeEdge(graph, p, q);
+                }
+            }
+            graph->generation += 1;
+        }
+    }
+    async_mutex_unlock(&graph->mutex);
+}
+
+void ljack_client_graph_port_renamed(LjackClientGraph* graph, const char* oldName, const char* newName)
+{
+    async_mutex_lock(&graph->mutex);
+    if (graph->valid) {
+        GraphPort* p = findByName(graph, oldName);
+        if (p) {
+            char* name = malloc(strlen(newName) + 1);
+            if (name) {
+                strcpy(name, newName);
+                unlinkByName(graph, p);
+                unlinkByPtr(graph, p);
+                free(p->name);
+                p->name = name;
+                linkPort(graph, p);
+            } else {
+                graph->valid = false;
+            }
+            graph->generation += 1;
+        }
+    }
+    async_mutex_unlock(&graph->mutex);
+}
+
+/* ============================================================================================ */
+
+bool ljack_client_graph_generation(LjackClientGraph* graph, bool activated, lua_Integer* generation)
+{
+    bool ok;
+    async_mutex_lock(&graph->mutex);
+    {
+        ok = prepare_LOCKED(graph, activated);
+        *generation = graph->generation;
+    }
+    async_mutex_unlock(&graph->mutex);
+    return ok;
+}
+
+bool ljack_client_graph_is_connected(LjackClientGraph* graph, bool activated,
+                                     const char* name1, const char* name2, bool* rslt)
+{
+    bool ok;
+    async_mutex_lock(&graph->mutex);
+    {
+        ok = prepare_LOCKED(graph, activated);
+        GraphPort* p = ok ? findByName(graph, name1) : NULL;
+        GraphPort* q = ok ? findByName(graph, name2) : NULL;
+        *rslt = p && q && *findEdge(graph, p, q);
+    }
+    async_mutex_unlock(&graph->mutex);
+    return ok;
+}
+
+bool ljack_client_graph_count_connections(LjackClientGraph* graph, bool activated,
+                                          const char* name, int* count)
+{
+    bool ok;
+    async_mutex_lock(&graph->mutex);
+    {
+        ok = prepare_LOCKED(graph, activated);
+        GraphPort* p = ok ? findByName(graph, name) : NULL;
+        *count = p ? p->connectedCount : 0;
+    }
+    async_mutex_unlock(&graph->mutex);
+    return ok;
+}
+
+bool ljack_client_graph_get_connections(LjackClientGraph* graph, bool activated,
+                                        const char* name, const char*** list)
+{
+    bool ok;
+    *list = NULL;
+    async_mutex_lock(&graph->mutex);
+    {
+        ok = prepare_LOCKED(graph, activated);
+        GraphPort* p = ok ? findByName(graph, name) : NULL;
+        if (p) {
+            size_t size = (p->connectedCount + 1) * sizeof(char*);
+            for (int i = 0; i < p->connectedCount; ++i) {
+                size += strlen(p->connected[i]->name) + 1;
+            }
+            const char** rslt = malloc(size);
+            if (rslt) {
+                char* s = (char*)(rslt + p->connectedCount + 1);
+                for (int i = 0; i < p->connectedCount; ++i) {
+                    strcpy(s, p->connected[i]->name);
+                    rslt[i] = s;
+                    s += strlen(s) + 1;
+                }
+                rslt[p->connectedCount] = NULL;
+                *list = rslt;
+            } else {
+                ok = false;
+            }
+        }
+    }
+    async_mutex_unlock(&graph->mutex);
+    return ok;
+}
+
+/* ============================================================================================ */
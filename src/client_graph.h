@@ -0,0 +1,62 @@
+#ifndef LJACK_CLIENT_GRAPH_H
+#define LJACK_CLIENT_GRAPH_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Local mirror of the ports and connections of the JACK graph. The mirror is 
+ * seeded from jack_get_ports() when it is used for the first time and is then 
+ * updated from the port registration, connect and rename callbacks of the client.
+ * Callbacks are only delivered to activated clients, therefore the mirror is 
+ * seeded again if it is used while the client is not activated.
+ */
+
+typedef struct LjackClientGraph LjackClientGraph;
+
+LjackClientGraph* ljack_client_graph_new(jack_client_t* client);
+
+void ljack_client_graph_free(LjackClientGraph* graph);
+
+/**
+ * Lets the mirror be seeded again when it is used the next time.
+ */
+void ljack_client_graph_invalidate(LjackClientGraph* graph);
+
+/* Are called from the JACK client callbacks. */
+
+void ljack_client_graph_port_registered(LjackClientGraph* graph, jack_port_id_t id, int registered);
+
+void ljack_client_graph_port_connected(LjackClientGraph* graph, jack_port_id_t a, jack_port_id_t b, 
+                                       int connected);
+
+void ljack_client_graph_port_renamed(LjackClientGraph* graph, const char* oldName, const char* newName);
+
+/* Are called from the Lua thread, return false if the mirror cannot be seeded. */
+
+bool ljack_client_graph_generation(LjackClientGraph* graph, bool activated, lua_Integer* generation);
+
+bool ljack_client_graph_is_connected(LjackClientGraph* graph, bool activated, 
+                                     const char* name1, const char* name2, bool* rslt);
+
+/**
+ * Sets *count to the number of ports connected to the given port, i.e. 0 if 
+ * there is no such port. Does not allocate memory if the mirror is not seeded.
+ */
+bool ljack_client_graph_count_connections(LjackClientGraph* graph, bool activated,
+                                          const char* name, int* count);
+
+/**
+ * Sets *list to a NULL terminated list with the names of the connected ports or
+ * to NULL if there is no such port. The list is allocated as one block that must
+ * be freed by calling free().
+ */
+bool ljack_client_graph_get_connections(LjackClientGraph* graph, bool activated,
+                                        const char* name, const char*** list);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_GRAPH_H */
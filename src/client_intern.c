@@ -5,8 +5,16 @@
 #include "util.h"
 #include "error.h"
 #include "receiver_capi.h"
+#include "status_codes.h"
 
 #include "client_intern.h"
+#include "client_workers.h"
+#include "client_events.h"
+#include "client_storage.h"
+#include "client_async.h"
+#include "client_graph.h"
+#include "client_patchbay.h"
+#include "client_coalescer.h"
 #include "port.h"
 #include "procbuf.h"
 #include "main.h"
@@ -18,6 +26,11 @@ typedef LjackProcBufUserData   ProcBufUserData;
 
 /* ============================================================================================ */
 
+static void addStatusToWriter(ClientUserData* udata, LjackStatusCode code)
+{
+    ljack_status_add_type(udata->receiver_capi, udata->receiver_writer, udata->compactStatus, code);
+}
+
 static void addBooleanToWriter(ClientUserData* udata, int b)
 {
     udata->receiver_capi->addBooleanToWriter(udata->receiver_writer, b);
@@ -55,8 +68,11 @@ static void addMsgToReceiver(ClientUserData* udata)
 static int jackGraphOrderCallback(void* arg)
 {
     ClientUserData* udata = arg;
-    if (udata->receiver) {
-        addStringToWriter(udata, "GraphOrder");
+    if (udata->coalescer) {
+        ljack_client_coalescer_graph_order(udata->coalescer);
+    }
+    else if (udata->receiver) {
+        addStatusToWriter(udata, LJACK_STATUS_GRAPH_ORDER);
         addMsgToReceiver (udata);
     }
     return 0;
@@ -65,8 +81,11 @@ static int jackGraphOrderCallback(void* arg)
 static void jackClientRegistrationCallback(const char* name, int registered, void* arg)
 {
     ClientUserData* udata = arg;
+    if (udata->coalescer) {
+        ljack_client_coalescer_flush(udata->coalescer);
+    }
     if (udata->receiver) {
-        addStringToWriter (udata, "ClientRegistration");
+        addStatusToWriter (udata, LJACK_STATUS_CLIENT_REGISTRATION);
         addStringToWriter (udata, name);
         addBooleanToWriter(udata, registered);
         addMsgToReceiver  (udata);
@@ -76,8 +95,17 @@ static void jackClientRegistrationCallback(const char* name, int registered, voi
 static void jackPortConnectCallback(jack_port_id_t a, jack_port_id_t b, int connected, void* arg)
 {
     ClientUserData* udata = arg;
-    if (udata->receiver) {
-        addStringToWriter (udata, "PortConnect");
+    if (udata->graph) {
+        ljack_client_graph_port_connected(udata->graph, a, b, connected);
+    }
+    if (ljack_client_patchbay_filter(udata, a, b, connected)) {
+        return;
+    }
+    if (udata->coalescer) {
+        ljack_client_coalescer_port_connect(udata->coalescer, a, b, connected);
+    }
+    else if (udata->receiver) {
+        addStatusToWriter (udata, LJACK_STATUS_PORT_CONNECT);
         addIntegerToWriter(udata, (lua_Integer)a);
         addIntegerToWriter(udata, (lua_Integer)b);
         addBooleanToWriter(udata, connected);
@@ -88,8 +116,14 @@ static void jackPortConnectCallback(jack_port_id_t a, jack_port_id_t b, int conn
 static void jackPortRegistrationCallback(jack_port_id_t port, int registered, void* arg)
 {
     ClientUserData* udata = arg;
-    if (udata->receiver) {
-        addStringToWriter (udata, "PortRegistration");
+    if (udata->graph) {
+        ljack_client_graph_port_registered(udata->graph, port, registered);
+    }
+    if (udata->coalescer) {
+        ljack_client_coalescer_port_registration(udata->coalescer, port, registered);
+    }
+    else if (udata->receiver) {
+        addStatusToWriter (udata, LJACK_STATUS_PORT_REGISTRATION);
         addIntegerToWriter(udata, (lua_Integer)port);
         addBooleanToWriter(udata, registered);
         addMsgToReceiver  (udata);
@@ -99,9 +133,14 @@ static void jackPortRegistrationCallback(jack_port_id_t port, int registered, vo
 static void jackPortRenameCallback(jack_port_id_t port, const char* old_name, const char* new_name, void* arg)
 {
     ClientUserData* udata = arg;
-
+    if (udata->graph) {
+        ljack_client_graph_port_renamed(udata->graph, old_name, new_name);
+    }
+    if (udata->coalescer) {
+        ljack_client_coalescer_flush(udata->coalescer);
+    }
     if (udata->receiver) {
-        addStringToWriter (udata, "PortRename");
+        addStatusToWriter (udata, LJACK_STATUS_PORT_RENAME);
         addIntegerToWriter(udata, (lua_Integer)port);
         addStringToWriter (udata, old_name);
         addStringToWriter (udata, new_name);
@@ -114,7 +153,7 @@ static int jackXRunCallback(void* arg)
     ClientUserData* udata = arg;
 
     if (udata->receiver) {
-        addStringToWriter (udata, "XRun");
+        addStatusToWriter (udata, LJACK_STATUS_XRUN);
         addMsgToReceiver  (udata);
     }
     return 0;
@@ -125,7 +164,7 @@ static void jackInfoShutdownCallback(jack_status_t code, const char* reason, voi
     ClientUserData* udata = arg;
 
     if (udata->receiver) {
-        addStringToWriter (udata, "Shutdown");
+        addStatusToWriter (udata, LJACK_STATUS_SHUTDOWN);
         addStringToWriter (udata, reason);
         addMsgToReceiver  (udata);
     }
@@ -136,6 +175,132 @@ static void jackInfoShutdownCallback(jack_status_t code, const char* reason, voi
     async_mutex_unlock(&udata->processMutex);
 }
 
+/* ============================================================================================ */
+
+typedef struct LatencyNode
+{
+    PortUserData*         portUdata;
+    jack_latency_range_t* range;
+    bool*                 valid;
+} LatencyNode;
+
+static void getLatencyNode(LjackConnectorInfo* info, LatencyNode* node)
+{
+    if (info->isProcBuf && info->procBufUdata->aliasPort) {
+        node->portUdata = info->procBufUdata->aliasPort;
+    } else {
+        node->portUdata = info->portUdata;
+    }
+    if (node->portUdata) {
+        node->range = &node->portUdata->latencyRange;
+        node->valid = &node->portUdata->latencyValid;
+    } else {
+        node->range = &info->procBufUdata->latencyRange;
+        node->valid = &info->procBufUdata->latencyValid;
+    }
+}
+
+/**
+ * For capture latency the values flow from the inputs of each processor to
+ * its outputs, for playback latency from the outputs to the inputs. Own ports
+ * on the source side get their latency from JACK, process buffers and own
+ * ports on the target side are computed here. Processors are visited in
+ * registration order, therefore chains of process buffers may need several
+ * passes until the values are stable.
+ */
+static void computeLatencies_LOCKED(ClientUserData* udata, jack_latency_callback_mode_t mode)
+{
+    LjackProcReg** list      = udata->procRegList;
+    int            n         = udata->procRegCount;
+    bool           isCapture = (mode == JackCaptureLatency);
+
+    for (int i = 0; i < n; ++i) {
+        LjackProcReg* reg = list[i];
+        for (int j = 0; j < reg->connectorCount; ++j) {
+            LatencyNode node;
+            getLatencyNode(reg->connectorInfos + j, &node);
+            *node.valid = false;
+        }
+    }
+    bool changed = true;
+    for (int pass = 0; changed && pass <= n; ++pass) {
+        changed = false;
+        for (int i = 0; i < n; ++i) {
+            LjackProcReg*        reg     = list[i];
+            jack_nframes_t       latency = ljack_client_intern_get_latency(udata, reg);
+            jack_latency_range_t in      = { UINT32_MAX, 0 };
+            for (int j = 0; j < reg->connectorCount; ++j) {
+                LjackConnectorInfo* info = reg->connectorInfos + j;
+                if (isCapture ? info->isInput : info->isOutput) {
+                    LatencyNode node;
+                    getLatencyNode(info, &node);
+                    jack_latency_range_t r;
+                    if (node.portUdata) {
+                        jack_port_get_latency_range(node.portUdata->port, mode, &r);
+                    } else if (*node.valid) {
+                        r = *node.range;
+                    } else {
+                        continue;
+                    }
+                    if (r.min < in.min) in.min = r.min;
+                    if (r.max > in.max) in.max = r.max;
+                }
+            }
+            if (in.min > in.max) {
+                in.min = 0;
+            }
+            in.min += latency;
+            in.max += latency;
+            for (int j = 0; j < reg->connectorCount; ++j) {
+                LjackConnectorInfo* info = reg->connectorInfos + j;
+                if (isCapture ? info->isOutput : info->isInput) {
+                    LatencyNode node;
+                    getLatencyNode(info, &node);
+                    if (!*node.valid) {
+                        *node.range = in;
+                        *node.valid = true;
+                        changed     = true;
+                    } else {
+                        if (in.min < node.range->min) { node.range->min = in.min; changed = true; }
+                        if (in.max > node.range->max) { node.range->max = in.max; changed = true; }
+                    }
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        LjackProcReg* reg = list[i];
+        for (int j = 0; j < reg->connectorCount; ++j) {
+            LjackConnectorInfo* info = reg->connectorInfos + j;
+            if (isCapture ? info->isOutput : info->isInput) {
+                LatencyNode node;
+                getLatencyNode(info, &node);
+                if (node.portUdata && *node.valid) {
+                    jack_port_set_latency_range(node.portUdata->port, mode, node.range);
+                }
+            }
+        }
+    }
+}
+
+static void jackLatencyCallback(jack_latency_callback_mode_t mode, void* arg)
+{
+    ClientUserData* udata = arg;
+
+    async_mutex_lock(&udata->processMutex);
+    {
+        computeLatencies_LOCKED(udata, mode);
+    }
+    async_mutex_unlock(&udata->processMutex);
+}
+
+void ljack_client_intern_recompute_latencies(ClientUserData* udata)
+{
+    if (udata->client && udata->activated) {
+        jack_recompute_total_latencies(udata->client);
+    }
+}
+
 
 static void adjustProcessorBufferSizes_LOCKED(ClientUserData* udata, LjackProcReg** procRegList, jack_nframes_t nframes)
 {
@@ -147,7 +312,7 @@ static void adjustProcessorBufferSizes_LOCKED(ClientUserData* udata, LjackProcRe
             if (!reg) {
                 break;
             }
-            if (reg->bufferSize != nframes) {
+            if (reg->bufferSize != nframes && reg->blockSize == 0) {
                 if (reg->bufferSizeCallback) {
                     int rc = reg->bufferSizeCallback(nframes, reg->processorData);
                     if (rc != 0) {
@@ -157,7 +322,7 @@ static void adjustProcessorBufferSizes_LOCKED(ClientUserData* udata, LjackProcRe
                             udata->shutdownReceived = true;
                             async_mutex_notify(&udata->processMutex);
                             if (udata->receiver) {
-                                addStringToWriter (udata, "ProcessingError");
+                                addStatusToWriter (udata, LJACK_STATUS_PROCESSING_ERROR);
                                 addStringToWriter (udata, "client invalidated because buffer size callback gives error");
                                 addStringToWriter (udata, reg->processorName);
                                 addIntegerToWriter(udata, rc);
@@ -174,46 +339,129 @@ static void adjustProcessorBufferSizes_LOCKED(ClientUserData* udata, LjackProcRe
 }
 
 
-static int jackBufferSizeCallback(jack_nframes_t nframes, void* arg)
+/**
+ * Size in bytes of a process buffer's storage for the given buffer size.
+ */
+size_t ljack_client_intern_procbuf_size(ClientUserData* udata, bool isAudio, jack_nframes_t nframes)
 {
-    ClientUserData* udata = arg;
+    size_t size = isAudio ? udata->audioBufferSize : udata->midiBufferSize;
+    if (nframes > udata->bufferSize && udata->bufferSize > 0) {
+        size = (size * nframes + udata->bufferSize - 1) / udata->bufferSize;
+    }
+    return size;
+}
+
+/**
+ * Preallocates larger arena chunks if the storage of the process buffers is too 
+ * small for the given buffer size. The storage in use is not modified, i.e. if 
+ * allocation fails, the process buffers remain usable for the current buffer size.
+ * The same is done for the buffers of asynchronous processors.
+ */
+bool ljack_client_intern_reserve_procbufs_LOCKED(ClientUserData* udata, jack_nframes_t nframes)
+{
+    if (!ljack_arena_reserve_LOCKED(&udata->arena, 
+                                    ljack_client_intern_procbuf_size(udata, true,  nframes),
+                                    ljack_client_intern_procbuf_size(udata, false, nframes)))
+    {
+        return false;
+    }
+    for (int i = 0; i < udata->procRegCount; ++i) {
+        LjackProcReg* reg = udata->procRegList[i];
+        if (reg->asyncLane && !ljack_client_async_reserve(reg->asyncLane, nframes)) {
+            return false;
+        }
+    }
+    return true;
+}
 
+/**
+ * Frees storage that was replaced in the buffer size callback.
+ */
+void ljack_client_intern_free_retired_procbufs(ClientUserData* udata)
+{
     async_mutex_lock(&udata->processMutex);
     {
-        if (udata->confirmedProcRegList != udata->activeProcRegList) {
-            udata->confirmedProcRegList = udata->activeProcRegList;
-            async_mutex_notify(&udata->processMutex);
+        ljack_arena_free_retired_LOCKED(&udata->arena);
+        for (int i = 0; i < udata->procRegCount; ++i) {
+            LjackProcReg* reg = udata->procRegList[i];
+            if (reg->asyncLane) {
+                ljack_client_async_free_retired(reg->asyncLane);
+            }
+        }
+    }
+    async_mutex_unlock(&udata->processMutex);
+}
+
+static void invalidateForAllocationError_LOCKED(ClientUserData* udata)
+{
+    if (!udata->severeProcessingError) {
+        ljack_log_error("LJACK: client invalidated because buffer allocation failed for process buffers.");
+        udata->severeProcessingError = true;
+        udata->shutdownReceived = true;
+        if (udata->receiver) {
+            addStatusToWriter (udata, LJACK_STATUS_PROCESSING_ERROR);
+            addStringToWriter (udata, "client invalidated because buffer allocation failed for process buffers");
+            addMsgToReceiver  (udata);
         }
+    }
+}
 
+/**
+ * Resizing process buffers only updates their length, as long as the new buffer
+ * size does not exceed maxBufferSize or larger arena chunks were prepared by 
+ * client:set_buffer_size(). Otherwise the chunks are allocated here before any
+ * process buffer is modified.
+ */
+static int jackBufferSizeCallback(jack_nframes_t nframes, void* arg)
+{
+    ClientUserData* udata = arg;
+
+    async_mutex_lock(&udata->processMutex);
+    {
         if (udata->bufferSize != nframes) {
             udata->bufferSize = nframes;
+            
+            /* buffers may be exchanged, silence flags of the previous cycle are not valid */
+            udata->processCycle += 2;
+            
             udata->audioBufferSize = jack_port_type_get_buffer_size(udata->client, JACK_DEFAULT_AUDIO_TYPE);
             udata->midiBufferSize  = jack_port_type_get_buffer_size(udata->client, JACK_DEFAULT_MIDI_TYPE);
-            ProcBufUserData*  procBufUdata = udata->firstProcBufUserData;
-            while (procBufUdata) {
-                if (procBufUdata->ringBuffer) {
-                    jack_ringbuffer_free(procBufUdata->ringBuffer);
-                    size_t size = procBufUdata->isAudio ? udata->audioBufferSize 
-                                                        : udata->midiBufferSize;
-                    procBufUdata->ringBuffer = jack_ringbuffer_create(size);
-                    ljack_procbuf_clear_midi_events(procBufUdata);
-                    if (procBufUdata->ringBuffer) {
-                        jack_ringbuffer_mlock(procBufUdata->ringBuffer);
-                    } else {
-                        if (!udata->severeProcessingError) {
-                            ljack_log_error("LJACK: client invalidated because buffer allocation failed for process buffer '%s'.", procBufUdata->procBufName);
-                            udata->severeProcessingError = true;
-                            udata->shutdownReceived = true;
-                            if (udata->receiver) {
-                                addStringToWriter (udata, "ProcessingError");
-                                addStringToWriter (udata, "client invalidated because buffer allocation failed for process buffer");
-                                addStringToWriter (udata, procBufUdata->procBufName);
-                                addMsgToReceiver  (udata);
-                            }
+
+            if (!ljack_client_intern_reserve_procbufs_LOCKED(udata, nframes)) {
+                invalidateForAllocationError_LOCKED(udata);
+            }
+            else {
+                if (nframes > udata->maxBufferSize) {
+                    udata->maxBufferSize = nframes;
+                }
+                ljack_arena_resize_LOCKED(&udata->arena);
+                for (int i = 0; i < udata->procRegCount; ++i) {
+                    LjackProcReg* reg = udata->procRegList[i];
+                    if (reg->asyncLane) {
+                        /* if the worker thread is busy, the process thread exchanges the buffers later */
+                        ljack_client_async_free_retired(reg->asyncLane);
+                        ljack_client_async_resize(reg->asyncLane);
+                    }
+                }
+
+                /* shared storage is applied again at the beginning of the next process cycle */
+                udata->appliedStorageGeneration = 0;
+                
+                /* the owners' buffer pointers already reflect the newest layout */
+                udata->appliedLayoutGeneration = udata->layoutGeneration;
+                
+                ProcBufUserData* procBufUdata = udata->firstProcBufUserData;
+                while (procBufUdata) {
+                    if (!procBufUdata->aliasPort) {
+                        procBufUdata->bufferLength = procBufUdata->isAudio ? udata->audioBufferSize 
+                                                                           : udata->midiBufferSize;
+                        if (!procBufUdata->sharedStorage) {
+                            ljack_procbuf_clear_midi_events(procBufUdata);
                         }
                     }
+                    ljack_procbuf_resize_segments_LOCKED(procBufUdata, udata->midiBufferSize);
+                    procBufUdata = procBufUdata->nextProcBufUserData;
                 }
-                procBufUdata = procBufUdata->nextProcBufUserData;
             }
             adjustProcessorBufferSizes_LOCKED(udata, udata->procRegList, nframes);
         }
@@ -221,7 +469,7 @@ static int jackBufferSizeCallback(jack_nframes_t nframes, void* arg)
     async_mutex_unlock(&udata->processMutex);
 
     if (udata->receiver) {
-        addStringToWriter (udata, "BufferSize");
+        addStatusToWriter (udata, LJACK_STATUS_BUFFER_SIZE);
         addIntegerToWriter(udata, (lua_Integer)nframes);
         addMsgToReceiver  (udata);
     }
@@ -232,99 +480,1051 @@ static int jackBufferSizeCallback(jack_nframes_t nframes, void* arg)
 
 typedef int ProcessCallback(jack_nframes_t nframes, void* processorData);
 
+void ljack_client_intern_update_proc_stats(LjackProcStats* stats, uint64_t nanos)
+{
+    uint32_t n = (nanos < UINT32_MAX) ? (uint32_t)nanos : UINT32_MAX;
+    
+    /* bucket 0: < 1us, bucket i: [2^(i-1), 2^i) us */
+    uint32_t micros = n / 1000;
+    int      bucket = 0;
+    while (micros != 0 && bucket < LJACK_PROC_STATS_BUCKETS - 1) {
+        micros >>= 1;
+        ++bucket;
+    }
+    atomic_inc(&stats->sequence);
+    {
+        if (atomic_get(&stats->resetRequested)) {
+            atomic_set(&stats->resetRequested, 0);
+            stats->count    = 0;
+            stats->sumNanos = 0;
+            stats->maxNanos = 0;
+            memset(stats->histogram, 0, sizeof(stats->histogram));
+        }
+        stats->count     += 1;
+        stats->sumNanos  += n;
+        stats->lastNanos  = n;
+        if (n > stats->maxNanos) {
+            stats->maxNanos = n;
+        }
+        stats->histogram[bucket] += 1;
+    }
+    atomic_inc(&stats->sequence);
+}
+
+/**
+ * Gives a consistent copy of the processor's statistics without blocking
+ * the process thread.
+ */
+void ljack_client_intern_read_proc_stats(LjackProcReg* reg, LjackProcStats* stats)
+{
+    while (true) {
+        int seq = atomic_get(&reg->stats.sequence);
+        if ((seq & 1) == 0) {
+            memcpy(stats, &reg->stats, sizeof(LjackProcStats));
+            if (atomic_get(&reg->stats.sequence) == seq) {
+                return;
+            }
+        }
+    }
+}
+
+static bool isAudioSilent(const jack_default_audio_sample_t* b, jack_nframes_t nframes)
+{
+    for (jack_nframes_t i = 0; i < nframes; ++i) {
+        if (b[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ljack_client_intern_port_is_silent(PortUserData* portUdata, jack_nframes_t nframes)
+{
+    if (portUdata->silentCycle == portUdata->clientUserData->processCycle) {
+        return true;
+    }
+    void* b = jack_port_get_buffer(portUdata->port, nframes);
+    if (portUdata->isAudio) {
+        return isAudioSilent(b, nframes);
+    } else {
+        return jack_midi_get_event_count(b) == 0;
+    }
+}
+
+void ljack_client_intern_port_set_silent(PortUserData* portUdata, jack_nframes_t nframes)
+{
+    uint32_t cycle = portUdata->clientUserData->processCycle;
+    if (portUdata->silentCycle != cycle) {
+        if (portUdata->silentCycle != cycle - 1) {
+            /* JACK keeps the buffer of an output port between process cycles */
+            void* b = jack_port_get_buffer(portUdata->port, nframes);
+            if (portUdata->isAudio) {
+                memset(b, 0, nframes * sizeof(jack_default_audio_sample_t));
+            } else {
+                jack_midi_clear_buffer(b);
+            }
+        }
+        portUdata->silentCycle = cycle;
+    }
+}
+
+bool ljack_client_intern_procbuf_is_silent(ProcBufUserData* procBufUdata, jack_nframes_t nframes)
+{
+    if (procBufUdata->aliasPort) {
+        return ljack_client_intern_port_is_silent(procBufUdata->aliasPort, nframes);
+    }
+    if (procBufUdata->silentCycle == procBufUdata->clientUserData->processCycle) {
+        return true;
+    }
+    if (procBufUdata->isAudio) {
+        return isAudioSilent((jack_default_audio_sample_t*)procBufUdata->buffer, nframes);
+    } else {
+        return procBufUdata->midiEventCount == 0;
+    }
+}
+
+void ljack_client_intern_procbuf_set_silent(ProcBufUserData* procBufUdata, jack_nframes_t nframes)
+{
+    if (procBufUdata->aliasPort) {
+        ljack_client_intern_port_set_silent(procBufUdata->aliasPort, nframes);
+        return;
+    }
+    uint32_t cycle = procBufUdata->clientUserData->processCycle;
+    if (procBufUdata->silentCycle != cycle) {
+        /* shared storage is overwritten by other process buffers, therefore
+         * it is not known to be silent from the previous cycle */
+        if (procBufUdata->silentCycle != cycle - 1 || procBufUdata->sharedStorage) {
+            if (procBufUdata->isAudio) {
+                memset(procBufUdata->buffer, 0, nframes * sizeof(jack_default_audio_sample_t));
+            } else {
+                ljack_procbuf_clear_midi_events(procBufUdata);
+            }
+        }
+        procBufUdata->silentCycle = cycle;
+    }
+}
+
+/* ============================================================================================ */
+
+static bool areInputsSilent(LjackProcReg* reg, jack_nframes_t nframes)
+{
+    bool hasInputs = false;
+    for (int i = 0, n = reg->connectorCount; i < n; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isInput) {
+            hasInputs = true;
+            if (info->isPort) {
+                if (!ljack_client_intern_port_is_silent(info->portUdata, nframes)) {
+                    return false;
+                }
+            } else if (info->isProcBuf) {
+                if (!ljack_client_intern_procbuf_is_silent(info->procBufUdata, nframes)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return hasInputs;
+}
+
+static void setOutputsSilent(LjackProcReg* reg, jack_nframes_t nframes)
+{
+    for (int i = 0, n = reg->connectorCount; i < n; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isOutput) {
+            if (info->isPort) {
+                ljack_client_intern_port_set_silent(info->portUdata, nframes);
+            } else if (info->midiSegment) {
+                ljack_procbuf_clear_segment(info->midiSegment);
+            } else if (info->isProcBuf) {
+                ljack_client_intern_procbuf_set_silent(info->procBufUdata, nframes);
+            }
+        }
+    }
+}
+
+/**
+ * Gives the time of the first MIDI event at or after the given time in any
+ * MIDI input connector of the processor or nframes if there is no such event.
+ */
+static jack_nframes_t nextMidiEventTime(LjackProcReg* reg, jack_nframes_t time, jack_nframes_t nframes)
+{
+    jack_nframes_t rslt = nframes;
+    for (int i = 0, n = reg->connectorCount; i < n; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isInput) {
+            PortUserData*    portUdata    = info->isPort    ? info->portUdata 
+                                          : info->isProcBuf ? info->procBufUdata->aliasPort
+                                                            : NULL;
+            ProcBufUserData* procBufUdata = (info->isProcBuf && !portUdata) ? info->procBufUdata : NULL;
+            jack_midi_event_t event;
+            if (portUdata && portUdata->isMidi) {
+                void*    b     = jack_port_get_buffer(portUdata->port, nframes);
+                uint32_t count = jack_midi_get_event_count(b);
+                for (uint32_t k = 0; k < count; ++k) {
+                    if (jack_midi_event_get(&event, b, k) == 0 && event.time >= time) {
+                        if (event.time < rslt) rslt = event.time;
+                        break;
+                    }
+                }
+            } else if (procBufUdata && procBufUdata->isMidi) {
+                uint32_t count = ljack_procbuf_get_midi_event_count(procBufUdata);
+                for (uint32_t k = 0; k < count; ++k) {
+                    if (ljack_procbuf_get_midi_event(&event, procBufUdata, k) == 0 && event.time >= time) {
+                        if (event.time < rslt) rslt = event.time;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return rslt;
+}
+
+/**
+ * Invokes the processor for sub-blocks that begin at MIDI event times. Each 
+ * sub-block has at least the client's minimum sub-block size, except if the 
+ * process cycle is shorter.
+ */
+static int runSubBlocks(ClientUserData* udata, LjackProcReg* reg, jack_nframes_t nframes)
+{
+    jack_nframes_t minSize = udata->minSubBlockSize;
+    jack_nframes_t offset  = 0;
+    int            rc      = 0;
+    while (offset < nframes && rc == 0) {
+        jack_nframes_t end = nframes;
+        if (nframes - offset >= 2 * minSize) {
+            end = nextMidiEventTime(reg, offset + minSize, nframes);
+            if (nframes - end < minSize) {
+                end = nframes;
+            }
+        }
+        reg->subBlockOffset = offset;
+        rc = reg->processCallback(end - offset, reg->processorData);
+        offset = end;
+    }
+    reg->subBlockOffset = 0;
+    return rc;
+}
+
+float* ljack_client_intern_get_audio_buffer(LjackConnectorInfo* info, jack_nframes_t nframes)
+{
+    PortUserData* portUdata = info->isPort    ? info->portUdata 
+                            : info->isProcBuf ? info->procBufUdata->aliasPort
+                                              : NULL;
+    if (portUdata) {
+        return jack_port_get_buffer(portUdata->port, nframes);
+    } else {
+        return (float*)info->procBufUdata->buffer;
+    }
+}
+
+/**
+ * Processors with internal block size read from and write into FIFOs of
+ * blockSize frames. The FIFOs are exchanged with the connectors in every process 
+ * cycle and the processor is invoked when a FIFO is full, i.e. the outputs are
+ * delayed by blockSize frames.
+ */
+static int runBlocks(LjackProcReg* reg, jack_nframes_t nframes)
+{
+    jack_nframes_t blockSize = reg->blockSize;
+    jack_nframes_t pos       = reg->blockPos;
+    jack_nframes_t done      = 0;
+    int            rc        = 0;
+    
+    reg->blockCleared = false;
+    while (done < nframes && rc == 0) {
+        jack_nframes_t k = blockSize - pos;
+        if (k > nframes - done) {
+            k = nframes - done;
+        }
+        for (int i = 0, n = reg->connectorCount; i < n; ++i) {
+            LjackConnectorInfo* info = reg->connectorInfos + i;
+            float*              b    = ljack_client_intern_get_audio_buffer(info, nframes);
+            if (info->isInput) {
+                memcpy(info->blockBuffer + pos, b + done, k * sizeof(float));
+            } else {
+                memcpy(b + done, info->blockBuffer + pos, k * sizeof(float));
+            }
+        }
+        pos  += k;
+        done += k;
+        if (pos == blockSize) {
+            rc  = reg->processCallback(blockSize, reg->processorData);
+            pos = 0;
+        }
+    }
+    reg->blockPos = pos;
+    return rc;
+}
+
+static void clearBlocks(LjackProcReg* reg)
+{
+    if (!reg->blockCleared) {
+        memset(reg->blockBuffers, 0, reg->connectorCount * reg->blockSize * sizeof(float));
+        reg->blockPos     = 0;
+        reg->blockCleared = true;
+    }
+}
+
+static bool hasOnlyAudioConnectors(LjackProcReg* reg)
+{
+    for (int i = 0; i < reg->connectorCount; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        bool isAudio = info->isPort ? info->portUdata->isAudio : info->procBufUdata->isAudio;
+        if (!isAudio) {
+            return false;
+        }
+    }
+    return true;
+}
+
+jack_nframes_t ljack_client_intern_get_latency(ClientUserData* udata, LjackProcReg* reg)
+{
+    if (reg->asyncLane) {
+        return reg->latency + ljack_client_async_get_delay(reg->asyncLane) * udata->bufferSize;
+    } else {
+        return reg->latency + reg->blockSize;
+    }
+}
+
+int ljack_client_intern_run_processor(ClientUserData* udata, LjackProcReg* reg,
+                                      bool activated, jack_nframes_t nframes)
+{
+    if (activated) {
+        if (reg->asyncLane) {
+            /* statistics are updated by the worker thread */
+            return ljack_client_async_run(reg->asyncLane, nframes);
+        }
+        if (reg->blockSize > 0) {
+            uint64_t t0 = async_clock_nanos();
+            int      rc = runBlocks(reg, nframes);
+            uint64_t t1 = async_clock_nanos();
+            ljack_client_intern_update_proc_stats(&reg->stats, t1 - t0);
+            return rc;
+        }
+        if (reg->silenceInOut && areInputsSilent(reg, nframes)) {
+            /* the processor would only produce silence */
+            setOutputsSilent(reg, nframes);
+            return 0;
+        }
+        ProcessCallback* processCallback = reg->processCallback;
+        uint64_t t0 = async_clock_nanos();
+        int      rc = reg->subBlocks ? runSubBlocks(udata, reg, nframes)
+                                     : processCallback(nframes, reg->processorData);
+        uint64_t t1 = async_clock_nanos();
+        ljack_client_intern_update_proc_stats(&reg->stats, t1 - t0);
+        return rc;
+    } 
+    else if (!reg->hidden && !atomic_get(&reg->suspended)) {
+        /* outputs of inactive processors are silent, clearing them is cheap if they
+         * were already silent in the previous process cycle */
+        setOutputsSilent(reg, nframes);
+        if (reg->blockSize > 0) {
+            clearBlocks(reg);
+        }
+        if (reg->asyncLane) {
+            ljack_client_async_reset(reg->asyncLane);
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Called in the process thread, logging and status message are delivered
+ * by the event thread.
+ */
+static void handleProcessingError(ClientUserData* udata, LjackProcReg* reg, int rc)
+{
+    atomic_set(&udata->severeProcessingError, true);
+    atomic_set(&udata->shutdownReceived, true);
+    
+    if (udata->events) {
+        ljack_client_events_push(udata->events, LJACK_EVENT_PROCESSING_ERROR, rc, 
+                                 reg->processorName);
+    }
+}
+
+/* ============================================================================================ */
+
+static int runExecList(ClientUserData* udata, LjackExecList* list, jack_nframes_t nframes)
+{
+    int m = 0;
+    for (int l = 0; l < list->levelCount; ++l) 
+    {
+        while (m < list->mergeCount && list->mergeLevels[m] == l) {
+            ljack_procbuf_merge_segments(list->mergeProcBufs[m++]);
+        }
+        LjackProcReg** levelList  = list->procList  + list->levelBegins[l];
+        bool*          activated  = list->activated + list->levelBegins[l];
+        int            levelCount = list->levelBegins[l + 1] - list->levelBegins[l];
+        
+        LjackProcReg* failedReg = NULL;
+        int           rc        = 0;
+        if (udata->workers && levelCount > 1) {
+            rc = ljack_client_workers_run(udata->workers, levelList, activated, levelCount, 
+                                          nframes, &failedReg);
+        } else {
+            for (int i = 0; i < levelCount; ++i) {
+                rc = ljack_client_intern_run_processor(udata, levelList[i], activated[i], nframes);
+                if (rc != 0) {
+                    failedReg = levelList[i];
+                    break;
+                }
+            }
+        }
+        if (rc != 0) {
+            handleProcessingError(udata, failedReg, rc);
+            return rc;
+        }
+    }
+    return 0;
+}
+
+static LJACK_ASYNC_THREAD_LOCAL bool isProcessingThread = false;
+
+void ljack_client_intern_mark_processing_thread(void)
+{
+    isProcessingThread = true;
+}
+
+bool ljack_client_intern_is_processing_thread(void)
+{
+    return isProcessingThread;
+}
+
+/* ============================================================================================ */
+
 static int jackProcessCallback(jack_nframes_t nframes, void* arg)
 {
     ClientUserData* udata = arg;
+    int rc = 0;
+    
+    isProcessingThread = true;
     
-    LjackProcReg** list = udata->activeProcRegList;
+    /* the exec list obtained here stays valid until cycleEndCounter is incremented,
+     * see ljack_client_intern_reclaim_exec_lists() */
+    atomic_inc(&udata->cycleBeginCounter);
+    udata->processCycle += 1;
+    
+    LjackExecList* list = atomic_get_ptr(&udata->activeExecList);
 
-    if (udata->confirmedProcRegList != list)
-    {
-        if (async_mutex_trylock(&udata->processMutex)) {
-            udata->confirmedProcRegList = list;
-            async_mutex_notify(&udata->processMutex);
-            async_mutex_unlock(&udata->processMutex);
+    if (list && !udata->shutdownReceived) {
+        ljack_client_storage_apply_layout(udata, list);
+        if (udata->shareProcBufs) {
+            ljack_client_storage_apply(udata, list);
         }
+        for (int i = 0; i < list->silentProcBufCount; ++i) {
+            ljack_client_intern_procbuf_set_silent(list->silentProcBufs[i], nframes);
+        }
+        rc = runExecList(udata, list, nframes);
     }
-    if (!udata->shutdownReceived)
-    {
-        if (list) {
-            int i = 0;
-            while (true) 
+    atomic_inc(&udata->cycleEndCounter);
+    return rc;
+}
+
+/* ============================================================================================ */
+
+static void adjustSchedWriterCounters(LjackProcReg* reg, int delta)
+{
+    for (int i = 0; i < reg->connectorCount; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isProcBuf && info->isOutput) {
+            info->procBufUdata->schedWriterCounter += delta;
+        }
+    }
+}
+
+/**
+ * Edge from all writers of a process buffer to one of its readers.
+ */
+typedef struct SchedEdge
+{
+    ProcBufUserData* procBuf;
+    int              reader;  /* index in procRegList */
+} SchedEdge;
+
+static int compareSchedEdges(const void* a, const void* b)
+{
+    const SchedEdge* e1 = a;
+    const SchedEdge* e2 = b;
+    if (e1->procBuf != e2->procBuf) {
+        return (e1->procBuf < e2->procBuf) ? -1 : 1;
+    }
+    return e1->reader - e2->reader;
+}
+
+static int compareInts(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+/**
+ * Returns the index of the first edge for procBuf in the sorted edges.
+ */
+static int firstSchedEdge(SchedEdge* edges, int edgeCount, ProcBufUserData* procBuf)
+{
+    int lo = 0;
+    int hi = edgeCount;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (edges[mid].procBuf < procBuf) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Is called after reg was placed into an execution level: readers of process
+ * buffers without unscheduled writers are added to the next level.
+ */
+static void releaseReaders(LjackProcReg** procRegList, LjackProcReg* reg, 
+                           SchedEdge* edges, int edgeCount,
+                           int* pending, int* ready, int* readyCount)
+{
+    for (int i = 0; i < reg->connectorCount; ++i) {
+        LjackConnectorInfo* info = reg->connectorInfos + i;
+        if (info->isProcBuf && info->isOutput && --info->procBufUdata->schedWriterCounter == 0) {
+            for (int j = firstSchedEdge(edges, edgeCount, info->procBufUdata);
+                 j < edgeCount && edges[j].procBuf == info->procBufUdata; ++j)
             {
-                LjackProcReg* reg = list[i];
-                if (!reg) {
-                    break;
+                int r = edges[j].reader;
+                if (--pending[r] == 0 && !procRegList[r]->scheduled) {
+                    ready[(*readyCount)++] = r;
                 }
-                ProcessCallback* processCallback = reg->processCallback;
-                if (reg->activated) {
-                    reg->outBuffersCleared = false;
-                    int rc = processCallback(nframes, reg->processorData);
-                    if (rc != 0) {
-                        async_mutex_lock(&udata->processMutex);
-                        {
-                            ljack_log_error("LJACK: client invalidated because processor '%s' returned processing error %d.", reg->processorName, rc);
-                            udata->severeProcessingError = true;
-                            udata->shutdownReceived = true;
-                            async_mutex_notify(&udata->processMutex);
+            }
+        }
+    }
+}
 
-                            if (udata->receiver) {
-                                addStringToWriter (udata, "ProcessingError");
-                                addStringToWriter (udata, "client invalidated because processor returned processing error");
-                                addStringToWriter (udata, reg->processorName);
-                                addIntegerToWriter(udata, rc);
-                                addMsgToReceiver  (udata);
-                            }
-                        }
-                        async_mutex_unlock(&udata->processMutex);
-                        return rc;
+/**
+ * Returns a new execution list for the processors of procRegList, i.e. every
+ * processor writing into a process buffer is placed in an earlier level than all 
+ * processors reading from this process buffer. Within one level the processors
+ * keep their registration order. The levels are computed in one topological
+ * pass over the edges from the writers to the readers of the process buffers.
+ * Process buffers that are read but not written by any processor are collected 
+ * in silentProcBufs.
+ *
+ * Returns NULL if memory could not be allocated. The returned list is freed 
+ * by calling free().
+ */
+LjackExecList* ljack_client_intern_new_exec_list(LjackProcReg** procRegList, int procRegCount)
+{
+    int edgeCount = 0;
+    for (int i = 0; i < procRegCount; ++i) {
+        LjackProcReg* reg = procRegList[i];
+        reg->scheduled = false;
+        for (int j = 0; j < reg->connectorCount; ++j) {
+            LjackConnectorInfo* info = reg->connectorInfos + j;
+            if (info->isProcBuf) {
+                info->procBufUdata->schedWriterCounter = 0;
+                if (info->isInput) {
+                    ++edgeCount;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < procRegCount; ++i) {
+        adjustSchedWriterCounters(procRegList[i], +1);
+    }
+    LjackExecList* list = calloc(1, sizeof(LjackExecList) 
+                                  + (procRegCount + 1) * sizeof(LjackProcReg*)
+                                  +  edgeCount         * sizeof(ProcBufUserData*) * 2
+                                  + (procRegCount + 1) * sizeof(int)
+                                  +  edgeCount         * sizeof(int)
+                                  +  procRegCount      * sizeof(bool));
+    if (!list) {
+        return NULL;
+    }
+    list->procList       = (LjackProcReg**)(list + 1);
+    list->silentProcBufs = (ProcBufUserData**)(list->procList + procRegCount + 1);
+    list->mergeProcBufs  = list->silentProcBufs + edgeCount;
+    list->levelBegins    = (int*)(list->mergeProcBufs + edgeCount);
+    list->mergeLevels    = list->levelBegins + procRegCount + 1;
+    list->activated      = (bool*)(list->mergeLevels + edgeCount);
+    
+    SchedEdge* edges   = malloc((edgeCount + 1) * sizeof(SchedEdge));
+    int*       pending = malloc((2 * procRegCount + 1) * sizeof(int));
+    if (!edges || !pending) {
+        free(edges);
+        free(pending);
+        free(list);
+        return NULL;
+    }
+    int* ready      = pending + procRegCount;
+    int  readyCount = 0;
+    int  e          = 0;
+    for (int i = 0; i < procRegCount; ++i) {
+        LjackProcReg* reg = procRegList[i];
+        pending[i] = 0;
+        for (int j = 0; j < reg->connectorCount; ++j) {
+            LjackConnectorInfo* info = reg->connectorInfos + j;
+            if (info->isProcBuf && info->isInput) {
+                edges[e].procBuf = info->procBufUdata;
+                edges[e].reader  = i;
+                ++e;
+                if (info->procBufUdata->schedWriterCounter > 0) {
+                    pending[i] += 1;
+                }
+            }
+        }
+        if (pending[i] == 0) {
+            ready[readyCount++] = i;
+        }
+    }
+    qsort(edges, edgeCount, sizeof(SchedEdge), compareSchedEdges);
+
+    /* readers may be registered before the writer, the process thread keeps
+     * such process buffers silent */
+    for (int j = 0; j < edgeCount; ++j) {
+        ProcBufUserData* procBuf = edges[j].procBuf;
+        if (   (j == 0 || edges[j - 1].procBuf != procBuf)
+            && procBuf->schedWriterCounter == 0 && procBuf->segmentCount == 0
+            && !(procBuf->aliasPort && procBuf->aliasPort->isInput))
+        {
+            list->silentProcBufs[list->silentProcBufCount++] = procBuf;
+        }
+    }
+
+    LjackProcReg** execList = list->procList;
+    int n = 0;
+    int l = 0;
+    int next = 0;
+    while (n < procRegCount) {
+        if (readyCount == 0) {
+            /* cyclic dependency, e.g. a processor reading its own output: the first 
+             * unscheduled processor is invoked anyway, its readers of the cycle get 
+             * the data of the previous process cycle */
+            while (procRegList[next]->scheduled) {
+                ++next;
+            }
+            ready[readyCount++] = next;
+        }
+        int levelBegin = n;
+        for (int i = 0; i < readyCount; ++i) {
+            LjackProcReg* reg = procRegList[ready[i]];
+            reg->scheduled = true;
+            execList[n++] = reg;
+        }
+        readyCount = 0;
+        for (int i = levelBegin; i < n; ++i) {
+            releaseReaders(procRegList, execList[i], edges, edgeCount, pending, ready, &readyCount);
+        }
+        qsort(ready, readyCount, sizeof(int), compareInts);
+        list->levelBegins[l++] = levelBegin;
+    }
+    free(edges);
+    free(pending);
+
+    execList[n] = NULL;
+    for (int i = 0; i < n; ++i) {
+        execList[i]->execIndex = i;
+        list->activated[i]     = execList[i]->activated;
+    }
+    list->procCount         = n;
+    list->levelCount        = l;
+    list->levelBegins[l]    = n;
+
+    /* MIDI process buffers with multiple writers are merged once before the first 
+     * level with a reader is invoked */
+    for (int level = 0; level < l; ++level) {
+        for (int k = list->levelBegins[level]; k < list->levelBegins[level + 1]; ++k) {
+            LjackProcReg* reg = execList[k];
+            for (int j = 0; j < reg->connectorCount; ++j) {
+                LjackConnectorInfo* info = reg->connectorInfos + j;
+                if (info->isProcBuf && info->isInput && info->procBufUdata->segmentCount > 0) {
+                    int m = 0;
+                    while (m < list->mergeCount && list->mergeProcBufs[m] != info->procBufUdata) {
+                        ++m;
                     }
-                } else if (!reg->outBuffersCleared) {
-                    for (int i = 0, n = reg->connectorCount; i < n; ++i) {
-                        LjackConnectorInfo* info = reg->connectorInfos + i;
-                        if (info->isOutput) {
-                            if (info->isPort) {
-                                if (info->portUdata->isAudio) {
-                                    jack_default_audio_sample_t* b = (jack_default_audio_sample_t*)jack_port_get_buffer(info->portUdata->port, nframes);
-                                    memset(b, 0, nframes * sizeof(jack_default_audio_sample_t));
-                                } else if (info->portUdata->isMidi) {
-                                    jack_midi_clear_buffer(jack_port_get_buffer(info->portUdata->port, nframes));
-                                }
-                            } else if (info->isProcBuf) {
-                                if (info->procBufUdata->isAudio) {
-                                    jack_default_audio_sample_t* b = (jack_default_audio_sample_t*)info->procBufUdata->ringBuffer->buf;
-                                    memset(b, 0, nframes * sizeof(jack_default_audio_sample_t));
-                                }
-                                else if (info->procBufUdata->isMidi) {
-                                    ljack_procbuf_clear_midi_events(info->procBufUdata);
-                                }
-                            }
-                        }
+                    if (m == list->mergeCount) {
+                        list->mergeProcBufs[m] = info->procBufUdata;
+                        list->mergeLevels[m]   = level;
+                        list->mergeCount      += 1;
                     }
-                    reg->outBuffersCleared = true;
                 }
-                ++i;
             }
         }
     }
-    return 0;
+    return list;
+}
+
+void ljack_client_intern_free_exec_list(LjackExecList* list)
+{
+    if (list) {
+        free(list->procBufs);
+        free(list->layoutProcBufs);
+        free(list);
+    }
 }
 
 /* ============================================================================================ */
 
-void ljack_client_intern_activate_proc_list_LOCKED(ClientUserData* udata, 
-                                                   LjackProcReg**  newList)
+/**
+ * Publishes the new exec list to the JACK process thread without waiting.
+ * The previous list is retired and freed later when it is no longer
+ * in use by a running process cycle.
+ */
+void ljack_client_intern_publish_exec_list(ClientUserData* udata, LjackExecList* newList)
 {
-    udata->activeProcRegList = newList;
-    
-    if (udata->activated) {
+    LjackExecList* oldList = atomic_set_ptr(&udata->activeExecList, newList);
+    if (oldList) {
+        /* every process cycle started after this point sees the new list */
+        oldList->retiredCycle = atomic_get(&udata->cycleBeginCounter);
+        oldList->nextRetired  = udata->retiredExecLists;
+        udata->retiredExecLists = oldList;
+    }
+    ljack_client_intern_reclaim_exec_lists(udata);
+}
+
+static bool hasCycleEnded(ClientUserData* udata, int cycle)
+{
+    /* unsigned arithmetic for handling counter overflow */
+    unsigned int ended = (unsigned int)atomic_get(&udata->cycleEndCounter);
+    return (int)(ended - (unsigned int)cycle) >= 0;
+}
+
+static bool isUnused(ClientUserData* udata, LjackExecList* list)
+{
+    return hasCycleEnded(udata, list->retiredCycle);
+}
+
+/**
+ * Frees all retired exec lists that are no longer used by the JACK process
+ * thread. Returns true if all retired lists could be freed.
+ */
+bool ljack_client_intern_reclaim_exec_lists(ClientUserData* udata)
+{
+    LjackExecList** ptr = &udata->retiredExecLists;
+    while (*ptr) {
+        LjackExecList* list = *ptr;
+        if (isUnused(udata, list)) {
+            *ptr = list->nextRetired;
+            ljack_client_intern_free_exec_list(list);
+        } else {
+            ptr = &list->nextRetired;
+        }
+    }
+    return udata->retiredExecLists == NULL;
+}
+
+/**
+ * Waits until all retired exec lists are no longer used by the JACK process
+ * thread, i.e. until all process cycles that were running during publishing
+ * have finished.
+ */
+void ljack_client_intern_wait_for_retired_exec_lists(ClientUserData* udata)
+{
+    if (!ljack_client_intern_reclaim_exec_lists(udata)) {
+        async_mutex_lock(&udata->processMutex);
         while (   atomic_get(&udata->shutdownReceived) == 0
-               && udata->confirmedProcRegList != newList) 
+               && !ljack_client_intern_reclaim_exec_lists(udata))
         {
-            async_mutex_wait(&udata->processMutex);
+            async_mutex_wait_millis(&udata->processMutex, 1);
+        }
+        async_mutex_unlock(&udata->processMutex);
+    }
+}
+
+/**
+ * Waits until the currently running process cycle has finished.
+ */
+static void waitForRunningCycle(ClientUserData* udata)
+{
+    int cycle = atomic_get(&udata->cycleBeginCounter);
+    if (!hasCycleEnded(udata, cycle)) {
+        async_mutex_lock(&udata->processMutex);
+        while (   atomic_get(&udata->shutdownReceived) == 0
+               && !hasCycleEnded(udata, cycle))
+        {
+            async_mutex_wait_millis(&udata->processMutex, 1);
+        }
+        async_mutex_unlock(&udata->processMutex);
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Ensures that procRegList has space for procRegCount entries plus the NULL
+ * terminator. The list grows exponentially, i.e. appending is amortized O(1).
+ */
+bool ljack_client_intern_reserve_proc_regs(ClientUserData* udata, int procRegCount)
+{
+    if (udata->procRegCapacity < procRegCount + 1) {
+        int newCapacity = 2 * udata->procRegCapacity;
+        if (newCapacity < procRegCount + 1) {
+            newCapacity = procRegCount + 1;
+        }
+        if (newCapacity < 8) {
+            newCapacity = 8;
+        }
+        async_mutex_lock(&udata->processMutex);
+        LjackProcReg** newList = realloc(udata->procRegList, newCapacity * sizeof(LjackProcReg*));
+        if (newList) {
+            if (!udata->procRegList) {
+                newList[0] = NULL;
+            }
+            udata->procRegList     = newList;
+            udata->procRegCapacity = newCapacity;
+        }
+        async_mutex_unlock(&udata->processMutex);
+        return newList != NULL;
+    }
+    return true;
+}
+
+/**
+ * Creates and publishes a new exec list from procRegList. Within a transaction
+ * the exec list is only marked as modified and is updated when the transaction
+ * is committed.
+ *
+ * Returns false if memory could not be allocated.
+ */
+bool ljack_client_intern_update_exec_list(ClientUserData* udata)
+{
+    if (udata->transactionDepth > 0) {
+        udata->execListDirty = true;
+        return true;
+    }
+    LjackExecList* list = ljack_client_intern_new_exec_list(udata->procRegList, udata->procRegCount);
+    if (list && udata->shareProcBufs && !ljack_client_storage_assign(udata, list)) {
+        ljack_client_intern_free_exec_list(list);
+        list = NULL;
+    }
+    if (list && !ljack_client_storage_layout(udata, list)) {
+        ljack_client_intern_free_exec_list(list);
+        list = NULL;
+    }
+    if (!list) {
+        udata->execListDirty = true;
+        return false;
+    }
+    udata->execListDirty = false;
+    ljack_client_intern_publish_exec_list(udata, list);
+
+    if (udata->detachedProcRegs) {
+        ljack_client_intern_wait_for_retired_exec_lists(udata);
+        ljack_client_intern_free_detached_proc_regs(udata);
+    }
+    if (udata->shareProcBufs && !udata->retiredExecLists) {
+        ljack_client_storage_trim(udata, list);
+    }
+    ljack_client_intern_recompute_latencies(udata);
+    return true;
+}
+
+static bool isInActiveExecList(ClientUserData* udata, LjackProcReg* reg, LjackExecList** list)
+{
+    *list = atomic_get_ptr(&udata->activeExecList);
+    return     *list 
+            && reg->execIndex >= 0
+            && reg->execIndex < (*list)->procCount 
+            && (*list)->procList[reg->execIndex] == reg;
+}
+
+/**
+ * Makes the activation state of the processor visible to the process thread. 
+ * Within a transaction this is deferred until the transaction is committed.
+ */
+void ljack_client_intern_set_exec_activated(ClientUserData* udata, LjackProcReg* reg)
+{
+    if (udata->transactionDepth > 0) {
+        udata->execListDirty = true;
+    } else {
+        LjackExecList* list;
+        if (isInActiveExecList(udata, reg, &list)) {
+            list->activated[reg->execIndex] = reg->activated;
+        }
+    }
+}
+
+/**
+ * Ensures that the process thread no longer invokes the processor or accesses
+ * its connectors although the processor is still contained in the active exec list.
+ */
+void ljack_client_intern_hide_proc_reg(ClientUserData* udata, LjackProcReg* reg)
+{
+    LjackExecList* list;
+    if (isInActiveExecList(udata, reg, &list)) {
+        list->activated[reg->execIndex] = false;
+        waitForRunningCycle(udata);
+        reg->hidden = true;
+        waitForRunningCycle(udata);
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Ensures that the process thread does not access the processor while its block size
+ * or asynchronous invocation is set. Returns false if the processor is still activated
+ * in the exec list that is used by the process thread, e.g. if it was deactivated within
+ * a transaction that is not yet committed. 
+ *
+ * The fields are published to the process thread by resumeProcReg(). The processMutex
+ * does not exclude the process thread, it only excludes the buffer size and latency 
+ * callbacks.
+ */
+static bool suspendProcReg(ClientUserData* udata, LjackProcReg* reg)
+{
+    LjackExecList* list;
+    if (isInActiveExecList(udata, reg, &list)) {
+        if (list->activated[reg->execIndex]) {
+            return false;
+        }
+        atomic_set(&reg->suspended, 1);
+        /* a process cycle may have seen the processor as inactive before */
+        waitForRunningCycle(udata);
+    }
+    return true;
+}
+
+static void resumeProcReg(LjackProcReg* reg)
+{
+    /* full barrier: stores to the processor are visible before it is accessed again */
+    atomic_set(&reg->suspended, 0);
+}
+
+void ljack_client_intern_set_block_size(lua_State* L, ClientUserData* udata, LjackProcReg* reg, 
+                                        jack_nframes_t blockSize)
+{
+    if (reg->activated) {
+        luaL_error(L, "cannot set block size for activated processor '%s'", reg->processorName);
+        return;
+    }
+    if (reg->blockSize != 0 || reg->asyncLane) {
+        luaL_error(L, "block size or asynchronous invocation already set for processor '%s'", reg->processorName);
+        return;
+    }
+    if (!hasOnlyAudioConnectors(reg)) {
+        luaL_error(L, "block size is only supported for processors with AUDIO connectors");
+        return;
+    }
+    float* blockBuffers = calloc((size_t)reg->connectorCount * blockSize + 1, sizeof(float));
+    if (!blockBuffers) {
+        luaL_error(L, "out of memory");
+        return;
+    }
+    if (!suspendProcReg(udata, reg)) {
+        free(blockBuffers);
+        luaL_error(L, "cannot set block size for processor '%s' that is activated in the process thread, "
+                      "commit the transaction first", reg->processorName);
+        return;
+    }
+    int rc = 0;
+    async_mutex_lock(&udata->processMutex);
+    {
+        if (reg->bufferSizeCallback) {
+            rc = reg->bufferSizeCallback(blockSize, reg->processorData);
+        }
+        if (rc == 0) {
+            for (int i = 0; i < reg->connectorCount; ++i) {
+                reg->connectorInfos[i].blockBuffer = blockBuffers + (size_t)i * blockSize;
+            }
+            reg->blockBuffers = blockBuffers;
+            reg->blockPos     = 0;
+            reg->blockCleared = true;
+            reg->bufferSize   = blockSize;
+            reg->blockSize    = blockSize;
+        }
+    }
+    async_mutex_unlock(&udata->processMutex);
+    resumeProcReg(reg);
+    if (rc != 0) {
+        free(blockBuffers);
+        luaL_error(L, "error %d from bufferSizeCallback for processor '%s'", rc, reg->processorName);
+        return;
+    }
+    ljack_client_intern_recompute_latencies(udata);
+}
+
+void ljack_client_intern_set_async(lua_State* L, ClientUserData* udata, LjackProcReg* reg, 
+                                   int delay)
+{
+    if (reg->activated) {
+        luaL_error(L, "cannot set asynchronous invocation for activated processor '%s'", reg->processorName);
+        return;
+    }
+    if (reg->blockSize != 0 || reg->asyncLane) {
+        luaL_error(L, "block size or asynchronous invocation already set for processor '%s'", reg->processorName);
+        return;
+    }
+    if (!hasOnlyAudioConnectors(reg)) {
+        luaL_error(L, "asynchronous invocation is only supported for processors with AUDIO connectors");
+        return;
+    }
+    LjackAsyncLane* lane = ljack_client_async_start(udata, reg, delay);
+    if (!lane) {
+        luaL_error(L, "cannot start thread for processor '%s'", reg->processorName);
+        return;
+    }
+    if (!suspendProcReg(udata, reg)) {
+        ljack_client_async_free(lane);
+        luaL_error(L, "cannot set asynchronous invocation for processor '%s' that is activated in the "
+                      "process thread, commit the transaction first", reg->processorName);
+        return;
+    }
+    async_mutex_lock(&udata->processMutex);
+    {
+        reg->asyncLane = lane;
+    }
+    async_mutex_unlock(&udata->processMutex);
+    resumeProcReg(reg);
+    ljack_client_intern_recompute_latencies(udata);
+}
+
+/**
+ * The declared latency is not used by the process thread, it is only read by the
+ * latency callback, which runs under processMutex.
+ */
+void ljack_client_intern_set_latency(ClientUserData* udata, LjackProcReg* reg, jack_nframes_t latency)
+{
+    if (reg->latency != latency) {
+        async_mutex_lock(&udata->processMutex);
+        {
+            reg->latency = latency;
+        }
+        async_mutex_unlock(&udata->processMutex);
+        ljack_client_intern_recompute_latencies(udata);
+    }
+}
+
+/* ============================================================================================ */
+
+void ljack_client_intern_begin_transaction(lua_State* L, ClientUserData* udata)
+{
+    udata->transactionDepth += 1;
+}
+
+void ljack_client_intern_commit_transaction(lua_State* L, ClientUserData* udata)
+{
+    if (udata->transactionDepth <= 0) {
+        luaL_error(L, "no transaction to commit");
+        return;
+    }
+    udata->transactionDepth -= 1;
+    if (udata->transactionDepth == 0 && udata->execListDirty) {
+        if (!ljack_client_intern_update_exec_list(udata)) {
+            luaL_error(L, "out of memory");
+        }
+    }
+}
+
+void ljack_client_intern_abort_transaction(ClientUserData* udata)
+{
+    if (udata->transactionDepth > 0) {
+        udata->transactionDepth -= 1;
+        if (udata->transactionDepth == 0 && udata->execListDirty) {
+            ljack_client_intern_update_exec_list(udata);
         }
     }
-    udata->confirmedProcRegList = newList;
 }
 
 /* ============================================================================================ */
@@ -351,8 +1551,12 @@ void ljack_client_intern_get_connector(lua_State* L, int arg,
 
 /* ============================================================================================ */
 
-void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg)
+void ljack_client_intern_detach_proc_reg(lua_State* L, LjackProcReg* reg)
 {
+    if (reg->asyncLane) {
+        /* processor data must no longer be accessed after detaching */
+        ljack_client_async_stop(reg->asyncLane);
+    }
     reg->processorData        = NULL;
     reg->processCallback      = NULL;
     reg->engineClosedCallback = NULL;
@@ -384,6 +1588,10 @@ void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg)
                         if (wasActivated) {
                             procBufUdata->outActiveCounter -= 1;
                         }
+                        if (reg->connectorInfos[i-1].midiSegment) {
+                            ljack_procbuf_release_segment(reg->connectorInfos[i-1].midiSegment);
+                            reg->connectorInfos[i-1].midiSegment = NULL;
+                        }
                     }
                 }
             }
@@ -394,6 +1602,18 @@ void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg)
         reg->connectorTableRef = LUA_REFNIL;
         reg->connectorCount = 0;
     }
+}
+
+void ljack_client_intern_free_proc_reg(LjackProcReg* reg)
+{
+    if (reg->asyncLane) {
+        ljack_client_async_free(reg->asyncLane);
+        reg->asyncLane = NULL;
+    }
+    if (reg->blockBuffers) {
+        free(reg->blockBuffers);
+        reg->blockBuffers = NULL;
+    }
     if (reg->connectorInfos) {
         free(reg->connectorInfos);
         reg->connectorInfos = NULL;
@@ -405,6 +1625,21 @@ void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg)
     free(reg);
 }
 
+void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg)
+{
+    ljack_client_intern_detach_proc_reg(L, reg);
+    ljack_client_intern_free_proc_reg(reg);
+}
+
+void ljack_client_intern_free_detached_proc_regs(ClientUserData* udata)
+{
+    while (udata->detachedProcRegs) {
+        LjackProcReg* reg = udata->detachedProcRegs;
+        udata->detachedProcRegs = reg->nextDetached;
+        ljack_client_intern_free_proc_reg(reg);
+    }
+}
+
 
 /* ============================================================================================ */
 
@@ -418,6 +1653,7 @@ void ljack_client_intern_register_callbacks(ClientUserData* udata)
     jack_set_buffer_size_callback         (udata->client, jackBufferSizeCallback,             udata);
     jack_set_xrun_callback                (udata->client, jackXRunCallback,                   udata);
     jack_set_process_callback             (udata->client, jackProcessCallback,                udata);
+    jack_set_latency_callback             (udata->client, jackLatencyCallback,                udata);
     
     jack_on_info_shutdown                 (udata->client, jackInfoShutdownCallback,           udata);
 }
@@ -1,11 +1,22 @@
 #ifndef LJACK_CLIENT_INTERN_H
 #define LJACK_CLIENT_INTERN_H
 
+#include "client_arena.h"
+
 typedef struct LjackClientUserData   LjackClientUserData;
 typedef struct LjackPortUserData     LjackPortUserData;
 typedef struct LjackProcReg          LjackProcReg;
 typedef struct LjackProcBufUserData  LjackProcBufUserData;
 typedef struct LjackConnectorInfo    LjackConnectorInfo;
+typedef struct LjackExecList         LjackExecList;
+typedef struct LjackClientWorkers    LjackClientWorkers;
+typedef struct LjackClientEvents     LjackClientEvents;
+typedef struct LjackSharedBlock      LjackSharedBlock;
+typedef struct LjackAsyncLane        LjackAsyncLane;
+typedef struct LjackMidiSegment      LjackMidiSegment;
+typedef struct LjackClientGraph      LjackClientGraph;
+typedef struct LjackPatchbay         LjackPatchbay;
+typedef struct LjackClientCoalescer  LjackClientCoalescer;
 
 struct LjackConnectorInfo
 {
@@ -16,8 +27,28 @@ struct LjackConnectorInfo
     
     LjackPortUserData*    portUdata;
     LjackProcBufUserData* procBufUdata;
+    
+    float*                blockBuffer;  /* FIFO for processors with internal block size */
+    LjackMidiSegment*     midiSegment;  /* writer's segment of a process buffer with multiple writers */
 };
 
+#define LJACK_PROC_STATS_BUCKETS 24
+
+/**
+ * Timing statistics of a processor. Written by the process thread,
+ * read by the Lua thread using the sequence counter (seqlock).
+ */
+typedef struct LjackProcStats
+{
+    AtomicCounter sequence;       /* odd while process thread is writing */
+    AtomicCounter resetRequested;
+    uint64_t      count;
+    uint64_t      sumNanos;
+    uint32_t      lastNanos;
+    uint32_t      maxNanos;
+    uint32_t      histogram[LJACK_PROC_STATS_BUCKETS]; /* log2 scale of microseconds */
+} LjackProcStats;
+
 struct LjackProcReg
 {
     void* processorData;
@@ -29,11 +60,59 @@ struct LjackProcReg
     char* processorName;
     jack_nframes_t bufferSize;
     jack_nframes_t sampleRate;
-    bool activated;
-    bool outBuffersCleared;
+    bool activated;          /* activation state on the Lua thread */
+    bool silenceInOut;       /* outputs are silent if all inputs are silent */
+    bool subBlocks;          /* invoked in sub-blocks split at MIDI event times */
+    jack_nframes_t subBlockOffset; /* offset of the current sub-block, only used in the process thread */
+    jack_nframes_t blockSize;      /* internal block size, 0 if invoked once per process cycle */
+    jack_nframes_t blockPos;       /* position within the internal block, only used in the process thread */
+    bool           blockCleared;   /* only used in the process thread */
+    float*         blockBuffers;   /* storage of the connectors' blockBuffer */
+    LjackAsyncLane* asyncLane;     /* invoked in a worker thread of its own, NULL otherwise */
+    jack_nframes_t latency;        /* latency declared by the processor */
+    bool hidden;             /* connectors must no longer be accessed */
+    AtomicCounter suspended; /* invocation mode is being changed, process thread must not
+                                access the processor, see suspendProcReg() */
+    bool scheduled;          /* only used while sorting on the Lua thread */
+    int  execIndex;          /* index in the most recently created exec list */
     int  connectorTableRef;
     int  connectorCount;
     LjackConnectorInfo* connectorInfos;
+    LjackProcReg* nextDetached;
+    LjackProcStats stats;
+};
+
+/**
+ * Processors in execution order, grouped into levels. Processors within
+ * one level do not depend on each other and may be executed in parallel.
+ */
+struct LjackExecList
+{
+    int            procCount;
+    int            levelCount;
+    LjackProcReg** procList;     /* procCount + 1 entries, NULL terminated */
+    int*           levelBegins;  /* levelCount + 1 entries, index into procList */
+    bool*          activated;    /* procCount entries, activation state seen by the process thread */
+    
+    int                    silentProcBufCount; /* process buffers that are read but have no writer */
+    LjackProcBufUserData** silentProcBufs;
+    
+    int                    mergeCount;         /* MIDI process buffers with multiple writers */
+    LjackProcBufUserData** mergeProcBufs;
+    int*                   mergeLevels;        /* first level reading the merged process buffer */
+    
+    int                    procBufCount;       /* only for shared process buffer storage */
+    LjackProcBufUserData** procBufs;
+    LjackSharedBlock**     procBufBlocks;
+    int                    storageGeneration;
+    
+    int                    layoutCount;        /* process buffers with storage of their own */
+    LjackProcBufUserData** layoutProcBufs;
+    char**                 layoutBuffers;
+    int                    layoutGeneration;
+    
+    LjackExecList* nextRetired;  /* only used on the Lua thread */
+    int            retiredCycle;
 };
 
 struct LjackClientUserData
@@ -47,6 +126,7 @@ struct LjackClientUserData
     const receiver_capi* receiver_capi;
     receiver_object*     receiver;
     receiver_writer*     receiver_writer;
+    bool                 compactStatus;     /* status message types as integer codes */
     
     int                  weakTableRef;
     int                  strongTableRef;
@@ -54,14 +134,42 @@ struct LjackClientUserData
     LjackPortUserData*     firstPortUserData;
     LjackProcBufUserData*  firstProcBufUserData;
     
-    LjackProcReg**         procRegList;
+    LjackProcReg**         procRegList;       /* in registration order, NULL terminated */
     int                    procRegCount;
-    LjackProcReg**         activeProcRegList;
-    LjackProcReg**         confirmedProcRegList;
+    int                    procRegCapacity;
+    LjackProcReg*          detachedProcRegs;  /* unregistered, to be freed after next publishing */
+    int                    transactionDepth;
+    bool                   execListDirty;
+    AtomicPtr              activeExecList;    /* LjackExecList*, read by the JACK process thread */
+    AtomicCounter          cycleBeginCounter;
+    AtomicCounter          cycleEndCounter;
+    uint32_t               processCycle;      /* only used in the process thread, for silence flags */
+    LjackExecList*         retiredExecLists;  /* waiting for running process cycles */
+    
+    LjackClientWorkers*    workers;
+    LjackClientEvents*     events;
+    LjackClientCoalescer*  coalescer;         /* NULL if status messages are not coalesced */
+    LjackClientGraph*      graph;             /* local mirror of the JACK graph */
+    LjackPatchbay*         patchbay;          /* pending changes of apply_connections() */
+    receiver_writer*       patchbayWriter;    /* own writer for the summaries of apply_connections(),
+                                                 guarded by processMutex */
+    
+    LjackArena             arena;               /* storage of all process buffers */
+    
+    bool                   shareProcBufs;       /* process buffers share storage blocks */
+    jack_nframes_t         minSubBlockSize;     /* for processors invoked in sub-blocks */
+    LjackSharedBlock**     sharedBlocks;
+    int                    sharedBlockCount;
+    int                    sharedBlockCapacity;
+    int                    storageGeneration;
+    int                    appliedStorageGeneration; /* only used in the process thread */
+    int                    layoutGeneration;
+    int                    appliedLayoutGeneration;  /* only used in the process thread */
     
     Mutex                processMutex;
     bool                 closed;
     jack_nframes_t       bufferSize;
+    jack_nframes_t       maxBufferSize;       /* process buffers have capacity for this size */
     jack_nframes_t       sampleRate;
     size_t               audioBufferSize;
     size_t               midiBufferSize;
@@ -69,11 +177,97 @@ struct LjackClientUserData
 
 void ljack_client_intern_register_callbacks(LjackClientUserData* udata);
 
-void ljack_client_intern_activate_proc_list_LOCKED(LjackClientUserData* udata,
-                                                   LjackProcReg**       newList);
+size_t ljack_client_intern_procbuf_size(LjackClientUserData* udata, bool isAudio, jack_nframes_t nframes);
+
+bool ljack_client_intern_reserve_procbufs_LOCKED(LjackClientUserData* udata, jack_nframes_t nframes);
+
+void ljack_client_intern_free_retired_procbufs(LjackClientUserData* udata);
+
+LjackExecList* ljack_client_intern_new_exec_list(LjackProcReg** procRegList, int procRegCount);
+
+void ljack_client_intern_free_exec_list(LjackExecList* list);
+
+bool ljack_client_intern_reserve_proc_regs(LjackClientUserData* udata, int procRegCount);
+
+bool ljack_client_intern_update_exec_list(LjackClientUserData* udata);
+
+void ljack_client_intern_set_exec_activated(LjackClientUserData* udata, LjackProcReg* reg);
+
+void ljack_client_intern_hide_proc_reg(LjackClientUserData* udata, LjackProcReg* reg);
+
+void ljack_client_intern_begin_transaction(lua_State* L, LjackClientUserData* udata);
+
+void ljack_client_intern_commit_transaction(lua_State* L, LjackClientUserData* udata);
+
+/**
+ * Ends the innermost transaction without raising a Lua error, the changes made so far 
+ * are kept. If the exec list cannot be updated, it is updated with the next change.
+ */
+void ljack_client_intern_abort_transaction(LjackClientUserData* udata);
+
+void ljack_client_intern_publish_exec_list(LjackClientUserData* udata, LjackExecList* newList);
+
+bool ljack_client_intern_reclaim_exec_lists(LjackClientUserData* udata);
+
+void ljack_client_intern_wait_for_retired_exec_lists(LjackClientUserData* udata);
+
+/**
+ * Marks the calling thread as process or worker thread: such threads must not
+ * block and give log messages to the event queue of the client.
+ */
+void ljack_client_intern_mark_processing_thread(void);
+
+bool ljack_client_intern_is_processing_thread(void);
+
+int ljack_client_intern_run_processor(LjackClientUserData* udata, LjackProcReg* reg,
+                                      bool activated, jack_nframes_t nframes);
+
+void ljack_client_intern_read_proc_stats(LjackProcReg* reg, LjackProcStats* stats);
+
+void ljack_client_intern_update_proc_stats(LjackProcStats* stats, uint64_t nanos);
+
+float* ljack_client_intern_get_audio_buffer(LjackConnectorInfo* info, jack_nframes_t nframes);
+
+void ljack_client_intern_set_block_size(lua_State* L, LjackClientUserData* udata, LjackProcReg* reg, 
+                                        jack_nframes_t blockSize);
+
+void ljack_client_intern_set_async(lua_State* L, LjackClientUserData* udata, LjackProcReg* reg, 
+                                   int delay);
+
+void ljack_client_intern_set_latency(LjackClientUserData* udata, LjackProcReg* reg, 
+                                     jack_nframes_t latency);
+
+/**
+ * Latency in frames of the processor: the declared latency and the latency that
+ * is added by internal block size or asynchronous invocation.
+ */
+jack_nframes_t ljack_client_intern_get_latency(LjackClientUserData* udata, LjackProcReg* reg);
+
+/**
+ * Lets JACK invoke the latency callback, e.g. after processors have been 
+ * registered or their latency has changed.
+ */
+void ljack_client_intern_recompute_latencies(LjackClientUserData* udata);
+
+/**
+ * Silence flags of connector buffers, only valid within the current process cycle.
+ * The is_silent functions also detect buffers that contain only zeros or no MIDI 
+ * events. The set_silent functions clear the buffer unless it is known to be 
+ * silent since the previous process cycle.
+ */
+bool ljack_client_intern_port_is_silent     (LjackPortUserData* portUdata,       jack_nframes_t nframes);
+void ljack_client_intern_port_set_silent    (LjackPortUserData* portUdata,       jack_nframes_t nframes);
+bool ljack_client_intern_procbuf_is_silent  (LjackProcBufUserData* procBufUdata, jack_nframes_t nframes);
+void ljack_client_intern_procbuf_set_silent (LjackProcBufUserData* procBufUdata, jack_nframes_t nframes);
+
+void ljack_client_intern_detach_proc_reg(lua_State* L, LjackProcReg* reg);
+
+void ljack_client_intern_free_proc_reg(LjackProcReg* reg);
 
 void ljack_client_intern_release_proc_reg(lua_State* L, LjackProcReg* reg);
 
+void ljack_client_intern_free_detached_proc_regs(LjackClientUserData* udata);
+
 void ljack_client_intern_get_connector(lua_State* L, int arg, 
                                        LjackPortUserData** portUdata, 
                                        LjackProcBufUserData** procBufUdata);
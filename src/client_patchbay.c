@@ -0,0 +1,498 @@
+#include <jack/jack.h>
+
+#include "util.h"
+#include "error.h"
+#include "receiver_capi.h"
+#include "status_codes.h"
+
+#include "client_intern.h"
+#include "client_patchbay.h"
+#include "client_graph.h"
+#include "port.h"
+#include "main.h"
+
+/* ============================================================================================ */
+
+typedef struct PatchbayEntry PatchbayEntry;
+typedef struct PatchbayPair  PatchbayPair;
+
+struct PatchbayEntry
+{
+    jack_port_t* src;           /* output port */
+    jack_port_t* dst;           /* input port */
+    bool         connect;
+    bool         pending;       /* waiting for port connect callback */
+    bool         failed;
+};
+
+/**
+ * Connections that were changed by the last invocation of client:apply_connections()
+ * and for which the port connect callback has not been called yet. Only exists while
+ * the client is activated, otherwise no callbacks arrive. Is guarded by processMutex.
+ */
+struct LjackPatchbay
+{
+    PatchbayEntry* entries;     /* sorted by port pointers */
+    int            count;
+    int            remaining;
+    int            connected;   /* counted from the return codes */
+    int            disconnected;
+    bool           armed;       /* all changes were given to the JACK server */
+};
+
+struct PatchbayPair
+{
+    jack_port_t* src;
+    jack_port_t* dst;
+    bool         exists;
+};
+
+/* ============================================================================================ */
+
+/* The summary is sent from the Lua thread or from the notification thread, it uses
+ * a writer of its own that is guarded by processMutex. */
+
+static void addStatusToWriter(LjackClientUserData* udata, LjackStatusCode code)
+{
+    ljack_status_add_type(udata->receiver_capi, udata->patchbayWriter, udata->compactStatus, code);
+}
+
+static void addIntegerToWriter(LjackClientUserData* udata, lua_Integer i)
+{
+    udata->receiver_capi->addIntegerToWriter(udata->patchbayWriter, i);
+}
+
+static void handleReceiverError(void* ehdata, const char* msg, size_t msglen)
+{
+    ljack_handle_error((error_handler_data*)ehdata, msg, msglen);
+}
+
+static void addMsgToReceiver(LjackClientUserData* udata)
+{
+    error_handler_data ehdata = {0};
+    udata->receiver_capi->msgToReceiver(udata->receiver, udata->patchbayWriter,
+                                        false, false, handleReceiverError, &ehdata);
+    if (ehdata.buffer) {
+        ljack_log_error("LJACK: Error while calling client callback.");
+        ljack_log_error(ehdata.buffer);
+        free(ehdata.buffer);
+    }
+}
+
+/* ============================================================================================ */
+
+static void freePatchbay(LjackPatchbay* pb)
+{
+    if (pb) {
+        free(pb->entries);
+        free(pb);
+    }
+}
+
+static void sendSummary_LOCKED(LjackClientUserData* udata, int connected, int disconnected)
+{
+    if (udata->receiver && (connected > 0 || disconnected > 0)) {
+        addStatusToWriter (udata, LJACK_STATUS_CONNECTIONS_APPLIED);
+        addIntegerToWriter(udata, connected);
+        addIntegerToWriter(udata, disconnected);
+        addMsgToReceiver  (udata);
+    }
+}
+
+/**
+ * Sends the summary if all notifications for the applied changes have arrived
+ * and releases the pending changes.
+ */
+static void finish_LOCKED(LjackClientUserData* udata)
+{
+    LjackPatchbay* pb = udata->patchbay;
+    if (pb->armed && pb->remaining == 0) {
+        sendSummary_LOCKED(udata, pb->connected, pb->disconnected);
+        udata->patchbay = NULL;
+        freePatchbay(pb);
+    }
+}
+
+
+/* ============================================================================================ */
+
+static int comparePointers(const void* a, const void* b)
+{
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+static int comparePortPointers(const void* a, const void* b)
+{
+    return comparePointers(*(jack_port_t* const*)a, *(jack_port_t* const*)b);
+}
+
+static int comparePairs(const void* a, const void* b)
+{
+    const PatchbayPair* p1 = a;
+    const PatchbayPair* p2 = b;
+    int c = comparePointers(p1->src, p2->src);
+    return (c != 0) ? c : comparePointers(p1->dst, p2->dst);
+}
+
+static int compareEntries(const void* a, const void* b)
+{
+    const PatchbayEntry* e1 = a;
+    const PatchbayEntry* e2 = b;
+    int c = comparePointers(e1->src, e2->src);
+    return (c != 0) ? c : comparePointers(e1->dst, e2->dst);
+}
+
+/* Port names start with the client name, i.e. sorting by names groups the changes by client. */
+static int compareEntryNames(const void* a, const void* b)
+{
+    const PatchbayEntry* e1 = a;
+    const PatchbayEntry* e2 = b;
+    int c = strcmp(jack_port_name(e1->src), jack_port_name(e2->src));
+    return (c != 0) ? c : strcmp(jack_port_name(e1->dst), jack_port_name(e2->dst));
+}
+
+/**
+ * Marks the entry as not waiting for a port connect callback.
+ */
+static void resolve_LOCKED(LjackClientUserData* udata, LjackPatchbay* pb, const PatchbayEntry* e)
+{
+    if (udata->patchbay == pb) {
+        PatchbayEntry* pe = bsearch(e, pb->entries, pb->count, sizeof(PatchbayEntry), compareEntries);
+        if (pe && pe->pending) {
+            pe->pending    = false;
+            pb->remaining -= 1;
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+static const char* nameFromValue(lua_State* L, int index, int i)
+{
+    if (lua_type(L, index) == LUA_TSTRING) {
+        return lua_tostring(L, index);
+    }
+    if (ljack_is_port_udata(L, index)) {
+        LjackPortUserData* portUdata = lua_touserdata(L, index);
+        if (portUdata->port) {
+            return jack_port_name(portUdata->port);
+        }
+    }
+    luaL_error(L, "bad connection at index %d (string or port object expected)", i);
+    return NULL;
+}
+
+static void addFailed(lua_State* L, int failedIndex, int* failedCount,
+                      const char* src, const char* dst, const char* op)
+{
+    lua_newtable(L);
+    lua_pushstring(L, src);
+    lua_rawseti(L, -2, 1);
+    lua_pushstring(L, dst);
+    lua_rawseti(L, -2, 2);
+    lua_pushstring(L, op);
+    lua_rawseti(L, -2, 3);
+    lua_rawseti(L, failedIndex, ++(*failedCount));
+}
+
+/* ============================================================================================ */
+
+int ljack_client_patchbay_apply(lua_State* L, LjackClientUserData* udata, int arg)
+{
+    jack_client_t* client = udata->client;
+
+    luaL_checktype(L, arg, LUA_TTABLE);
+    int n = lua_rawlen(L, arg);
+
+    luaL_checkstack(L, 20, NULL);
+    lua_newtable(L);                                           /* -> rslt */
+    int rsltIndex = lua_gettop(L);
+    lua_newtable(L);                                           /* -> rslt, failed */
+    int failedIndex = lua_gettop(L);
+    int failedCount = 0;
+
+    /* scratch memory is managed by the garbage collector, Lua errors cannot leak it */
+
+    PatchbayPair* pairs = lua_newuserdata(L, (n + 1) * sizeof(PatchbayPair));
+    int           m     = 0;
+    for (int i = 1; i <= n; ++i) {
+        if (lua_rawgeti(L, arg, i) != LUA_TTABLE) {           /* -> ..., pair */
+            return luaL_error(L, "bad connection at index %d (table expected)", i);
+        }
+        lua_rawgeti(L, -1, 1);                                 /* -> ..., pair, src */
+        lua_rawgeti(L, -2, 2);                                 /* -> ..., pair, src, dst */
+        const char*  srcName = nameFromValue(L, -2, i);
+        const char*  dstName = nameFromValue(L, -1, i);
+        jack_port_t* src     = jack_port_by_name(client, srcName);
+        jack_port_t* dst     = jack_port_by_name(client, dstName);
+        if (src && dst && (jack_port_flags(src) & JackPortIsInput)) {
+            jack_port_t* p = src; src = dst; dst = p;
+        }
+        if (   !src || !dst
+            || !(jack_port_flags(src) & JackPortIsOutput)
+            || !(jack_port_flags(dst) & JackPortIsInput))
+        {
+            addFailed(L, failedIndex, &failedCount, srcName, dstName, "connect");
+        } else {
+            pairs[m].src    = src;
+            pairs[m].dst    = dst;
+            pairs[m].exists = false;
+            ++m;
+        }
+        lua_pop(L, 3);                                         /* -> ... */
+    }
+    if (m > 0) {
+        qsort(pairs, m, sizeof(PatchbayPair), comparePairs);
+        int k = 1;
+        for (int i = 1; i < m; ++i) {
+            if (comparePairs(pairs + i, pairs + k - 1) != 0) {
+                pairs[k++] = pairs[i];
+            }
+        }
+        m = k;
+    }
+
+    /* all ports given in the list */
+
+    jack_port_t** ports     = lua_newuserdata(L, (2 * m + 1) * sizeof(jack_port_t*));
+    int           portCount = 0;
+    for (int i = 0; i < m; ++i) {
+        ports[portCount++] = pairs[i].src;
+        ports[portCount++] = pairs[i].dst;
+    }
+    if (portCount > 0) {
+        qsort(ports, portCount, sizeof(jack_port_t*), comparePortPointers);
+        int k = 1;
+        for (int i = 1; i < portCount; ++i) {
+            if (ports[i] != ports[k - 1]) {
+                ports[k++] = ports[i];
+            }
+        }
+        portCount = k;
+    }
+
+    /* current connections of these ports from the graph mirror. Without activation
+       the mirror is seeded again whenever it is used, i.e. it is only seeded by 
+       the first query and the following queries use the seeded mirror. */
+
+    int capacity = 0;
+    for (int i = 0; i < portCount; ++i) {
+        int count;
+        if (!ljack_client_graph_count_connections(udata->graph, udata->activated || i > 0,
+                                                  jack_port_name(ports[i]), &count)) {
+            return luaL_error(L, "out of memory");
+        }
+        capacity += count;
+    }
+    PatchbayEntry* changes = lua_newuserdata(L, (capacity + m + 1) * sizeof(PatchbayEntry));
+    int            disconnectCount = 0;
+    for (int i = 0; i < portCount; ++i) {
+        jack_port_t* p        = ports[i];
+        bool         isOutput = (jack_port_flags(p) & JackPortIsOutput);
+        const char** cons;
+        if (!ljack_client_graph_get_connections(udata->graph, true, jack_port_name(p), &cons)) {
+            return luaL_error(L, "out of memory");
+        }
+        if (cons) {
+            for (int j = 0; cons[j]; ++j) {
+                jack_port_t* q = jack_port_by_name(client, cons[j]);
+                if (!q) {
+                    continue;
+                }
+                PatchbayPair key = { isOutput ? p : q, isOutput ? q : p, false };
+                PatchbayPair* found = (m > 0) ? bsearch(&key, pairs, m, sizeof(PatchbayPair), comparePairs)
+                                              : NULL;
+                if (found) {
+                    found->exists = true;
+                }
+                else if (disconnectCount < capacity) {
+                    PatchbayEntry* e = changes + disconnectCount++;
+                    e->src     = key.src;
+                    e->dst     = key.dst;
+                    e->connect = false;
+                    e->pending = true;
+                    e->failed  = false;
+                }
+            }
+            free(cons);
+        }
+    }
+    if (disconnectCount > 0) {
+        /* a connection between two given ports was found twice */
+        qsort(changes, disconnectCount, sizeof(PatchbayEntry), compareEntries);
+        int k = 1;
+        for (int i = 1; i < disconnectCount; ++i) {
+            if (compareEntries(changes + i, changes + k - 1) != 0) {
+                changes[k++] = changes[i];
+            }
+        }
+        disconnectCount = k;
+        qsort(changes, disconnectCount, sizeof(PatchbayEntry), compareEntryNames);
+    }
+    int changeCount = disconnectCount;
+    int unchanged   = 0;
+    for (int i = 0; i < m; ++i) {
+        if (pairs[i].exists) {
+            ++unchanged;
+        } else {
+            PatchbayEntry* e = changes + changeCount++;
+            e->src     = pairs[i].src;
+            e->dst     = pairs[i].dst;
+            e->connect = true;
+            e->pending = true;
+            e->failed  = false;
+        }
+    }
+    if (changeCount > disconnectCount) {
+        qsort(changes + disconnectCount, changeCount - disconnectCount, sizeof(PatchbayEntry),
+              compareEntryNames);
+    }
+
+    /* register pending changes for the port connect callback, without activation
+       no callbacks arrive */
+
+    LjackPatchbay* pb = NULL;
+    if (changeCount > 0 && udata->activated) {
+        pb = calloc(1, sizeof(LjackPatchbay));
+        if (pb) {
+            pb->entries = malloc(changeCount * sizeof(PatchbayEntry));
+            if (!pb->entries) {
+                free(pb);
+                pb = NULL;
+            }
+        }
+        if (!pb) {
+            return luaL_error(L, "out of memory");
+        }
+        memcpy(pb->entries, changes, changeCount * sizeof(PatchbayEntry));
+        qsort(pb->entries, changeCount, sizeof(PatchbayEntry), compareEntries);
+        pb->count     = changeCount;
+        pb->remaining = changeCount;
+
+        async_mutex_lock(&udata->processMutex);
+        freePatchbay(udata->patchbay);
+        udata->patchbay = pb;
+        async_mutex_unlock(&udata->processMutex);
+    }
+
+    /* disconnect before connect */
+
+    int connected    = 0;
+    int disconnected = 0;
+    for (int i = 0; i < changeCount; ++i) {
+        PatchbayEntry* e       = changes + i;
+        const char*    srcName = jack_port_name(e->src);
+        const char*    dstName = jack_port_name(e->dst);
+        bool           notified;
+        if (e->connect) {
+            int rc   = jack_connect(client, srcName, dstName);
+            e->failed = (rc != 0 && rc != EEXIST);
+            notified  = (rc == 0);
+            if (rc == 0) {
+                ++connected;
+            } else if (rc == EEXIST) {
+                ++unchanged;
+            }
+        } else {
+            int rc   = jack_disconnect(client, srcName, dstName);
+            e->failed = (rc != 0);
+            notified  = (rc == 0);
+            if (rc == 0) {
+                ++disconnected;
+            }
+        }
+        if (!notified && pb) {
+            async_mutex_lock(&udata->processMutex);
+            resolve_LOCKED(udata, pb, e);
+            async_mutex_unlock(&udata->processMutex);
+        }
+    }
+    if (changeCount > 0) {
+        async_mutex_lock(&udata->processMutex);
+        if (pb && udata->patchbay == pb) {
+            pb->connected    = connected;
+            pb->disconnected = disconnected;
+            pb->armed        = true;
+            finish_LOCKED(udata);
+        }
+        else if (!pb) {
+            sendSummary_LOCKED(udata, connected, disconnected);
+        }
+        async_mutex_unlock(&udata->processMutex);
+    }
+
+    /* summary */
+
+    for (int i = 0; i < changeCount; ++i) {
+        PatchbayEntry* e = changes + i;
+        if (e->failed) {
+            addFailed(L, failedIndex, &failedCount, jack_port_name(e->src), jack_port_name(e->dst),
+                      e->connect ? "connect" : "disconnect");
+        }
+    }
+    lua_settop(L, failedIndex);                                /* -> rslt, failed */
+    lua_setfield(L, rsltIndex, "failed");                      /* -> rslt */
+    lua_pushinteger(L, connected);
+    lua_setfield(L, rsltIndex, "connected");
+    lua_pushinteger(L, disconnected);
+    lua_setfield(L, rsltIndex, "disconnected");
+    lua_pushinteger(L, unchanged);
+    lua_setfield(L, rsltIndex, "unchanged");
+    return 1;
+}
+
+/* ============================================================================================ */
+
+bool ljack_client_patchbay_filter(LjackClientUserData* udata, jack_port_id_t a, jack_port_id_t b,
+                                  int connected)
+{
+    jack_port_t* pa = jack_port_by_id(udata->client, a);
+    jack_port_t* pb = jack_port_by_id(udata->client, b);
+    if (!pa || !pb) {
+        return false;
+    }
+    bool          isOutput = (jack_port_flags(pa) & JackPortIsOutput);
+    PatchbayEntry key      = { isOutput ? pa : pb, isOutput ? pb : pa, false, false, false };
+    bool          matched  = false;
+
+    async_mutex_lock(&udata->processMutex);
+    LjackPatchbay* patchbay = udata->patchbay;
+    if (patchbay) {
+        PatchbayEntry* e = bsearch(&key, patchbay->entries, patchbay->count, sizeof(PatchbayEntry),
+                                   compareEntries);
+        if (e && e->pending && e->connect == (connected != 0)) {
+            e->pending           = false;
+            patchbay->remaining -= 1;
+            matched = true;
+            finish_LOCKED(udata);
+        }
+    }
+    async_mutex_unlock(&udata->processMutex);
+    return matched;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_patchbay_deactivated(LjackClientUserData* udata)
+{
+    async_mutex_lock(&udata->processMutex);
+    LjackPatchbay* pb = udata->patchbay;
+    if (pb) {
+        for (int i = 0; i < pb->count; ++i) {
+            pb->entries[i].pending = false;
+        }
+        pb->remaining = 0;
+        finish_LOCKED(udata);
+    }
+    async_mutex_unlock(&udata->processMutex);
+}
+
+/* ============================================================================================ */
+
+void ljack_client_patchbay_free(LjackClientUserData* udata)
+{
+    freePatchbay(udata->patchbay);
+    udata->patchbay = NULL;
+}
+
+/* ============================================================================================ */
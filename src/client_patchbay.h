@@ -0,0 +1,38 @@
+#ifndef LJACK_CLIENT_PATCHBAY_H
+#define LJACK_CLIENT_PATCHBAY_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+typedef struct LjackClientUserData LjackClientUserData;
+typedef struct LjackPatchbay       LjackPatchbay;
+
+/**
+ * Brings the connections of the ports given in the list at stack index arg into
+ * the desired state and pushes a summary table, see client:apply_connections().
+ */
+int ljack_client_patchbay_apply(lua_State* L, LjackClientUserData* udata, int arg);
+
+/**
+ * Is called from the port connect callback. Returns true if the notification
+ * belongs to a connection that was changed by ljack_client_patchbay_apply(). 
+ * In this case no PortConnect status message should be sent: instead one 
+ * ConnectionsApplied status message is sent for all changed connections.
+ */
+bool ljack_client_patchbay_filter(LjackClientUserData* udata, jack_port_id_t a, jack_port_id_t b,
+                                  int connected);
+
+/**
+ * Is called after the client was deactivated. No port connect callbacks arrive
+ * anymore, i.e. pending changes are released and the summary is sent.
+ */
+void ljack_client_patchbay_deactivated(LjackClientUserData* udata);
+
+void ljack_client_patchbay_free(LjackClientUserData* udata);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_PATCHBAY_H */
@@ -0,0 +1,352 @@
+#include <limits.h>
+
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#include "util.h"
+#include "receiver_capi.h"
+
+#include "client_intern.h"
+#include "client_storage.h"
+#include "procbuf.h"
+
+typedef LjackClientUserData    ClientUserData;
+typedef LjackProcBufUserData   ProcBufUserData;
+typedef LjackSharedBlock       SharedBlock;
+
+/* ============================================================================================ */
+
+typedef struct Lifetime
+{
+    ProcBufUserData* procBuf;
+    int              writerLevel;     /* -1 if there is no writer */
+    int              firstReaderLevel;
+    int              lastReaderLevel;
+    int              begin;
+    int              end;
+} Lifetime;
+
+static int compareLifetimes(const void* a, const void* b)
+{
+    int ba = ((const Lifetime*)a)->begin;
+    int bb = ((const Lifetime*)b)->begin;
+    return (ba < bb) ? -1 : (ba > bb) ? 1 : 0;
+}
+
+static bool usesSharedStorage(LjackConnectorInfo* info)
+{
+    return info->isProcBuf && info->procBufUdata->sharedStorage;
+}
+
+/* ============================================================================================ */
+
+static SharedBlock* newBlock_LOCKED(ClientUserData* udata, bool isAudio)
+{
+    if (udata->sharedBlockCount == udata->sharedBlockCapacity) {
+        int newCapacity = 2 * udata->sharedBlockCapacity;
+        if (newCapacity < 8) {
+            newCapacity = 8;
+        }
+        SharedBlock** newBlocks = realloc(udata->sharedBlocks, newCapacity * sizeof(SharedBlock*));
+        if (!newBlocks) {
+            return NULL;
+        }
+        udata->sharedBlocks        = newBlocks;
+        udata->sharedBlockCapacity = newCapacity;
+    }
+    SharedBlock* block = calloc(1, sizeof(SharedBlock));
+    if (!block) {
+        return NULL;
+    }
+    block->arenaSlot = ljack_arena_alloc_LOCKED(&udata->arena, isAudio, &block->buffer);
+    if (block->arenaSlot < 0) {
+        free(block);
+        return NULL;
+    }
+    block->isAudio = isAudio;
+    udata->sharedBlocks[udata->sharedBlockCount++] = block;
+    return block;
+}
+
+static void freeBlock_LOCKED(ClientUserData* udata, SharedBlock* block)
+{
+    ljack_arena_free_LOCKED(&udata->arena, block->isAudio, block->arenaSlot);
+    free(block);
+}
+
+/* ============================================================================================ */
+
+/**
+ * A process buffer without writer or with a reader that is not invoked after
+ * the writer keeps its data between process cycles and therefore gets a storage
+ * block of its own.
+ */
+static void computeLifetimes(LjackExecList* list, Lifetime* lifetimes)
+{
+    for (int l = 0; l < list->levelCount; ++l) {
+        for (int k = list->levelBegins[l]; k < list->levelBegins[l + 1]; ++k) {
+            LjackProcReg* reg = list->procList[k];
+            for (int i = 0; i < reg->connectorCount; ++i) {
+                LjackConnectorInfo* info = reg->connectorInfos + i;
+                if (usesSharedStorage(info)) {
+                    Lifetime* t = lifetimes + info->procBufUdata->storageIndex;
+                    if (info->isOutput) {
+                        t->writerLevel = l;
+                    } else {
+                        if (l < t->firstReaderLevel) t->firstReaderLevel = l;
+                        if (l > t->lastReaderLevel)  t->lastReaderLevel  = l;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool ljack_client_storage_assign(ClientUserData* udata, LjackExecList* list)
+{
+    int count = 0;
+    for (int k = 0; k < list->procCount; ++k) {
+        LjackProcReg* reg = list->procList[k];
+        for (int i = 0; i < reg->connectorCount; ++i) {
+            if (usesSharedStorage(reg->connectorInfos + i)) {
+                reg->connectorInfos[i].procBufUdata->storageIndex = -1;
+            }
+        }
+    }
+    for (int k = 0; k < list->procCount; ++k) {
+        LjackProcReg* reg = list->procList[k];
+        for (int i = 0; i < reg->connectorCount; ++i) {
+            LjackConnectorInfo* info = reg->connectorInfos + i;
+            if (usesSharedStorage(info) && info->procBufUdata->storageIndex < 0) {
+                info->procBufUdata->storageIndex = count++;
+            }
+        }
+    }
+    Lifetime* lifetimes = NULL;
+    if (count > 0) {
+        lifetimes       = malloc(count * sizeof(Lifetime));
+        list->procBufs  = malloc(count * (sizeof(ProcBufUserData*) + sizeof(SharedBlock*)));
+        if (!lifetimes || !list->procBufs) {
+            free(lifetimes);
+            free(list->procBufs);
+            list->procBufs = NULL;
+            return false;
+        }
+        list->procBufBlocks = (SharedBlock**)(list->procBufs + count);
+    }
+    for (int k = 0; k < list->procCount; ++k) {
+        LjackProcReg* reg = list->procList[k];
+        for (int i = 0; i < reg->connectorCount; ++i) {
+            LjackConnectorInfo* info = reg->connectorInfos + i;
+            if (usesSharedStorage(info)) {
+                Lifetime* t = lifetimes + info->procBufUdata->storageIndex;
+                t->procBuf          = info->procBufUdata;
+                t->writerLevel      = -1;
+                t->firstReaderLevel = INT_MAX;
+                t->lastReaderLevel  = -1;
+            }
+        }
+    }
+    computeLifetimes(list, lifetimes);
+    for (int i = 0; i < count; ++i) {
+        Lifetime* t = lifetimes + i;
+        if (t->writerLevel < 0 || t->firstReaderLevel <= t->writerLevel) {
+            t->begin = -1;
+            t->end   = INT_MAX;
+        } else {
+            t->begin = t->writerLevel;
+            t->end   = (t->lastReaderLevel > t->writerLevel) ? t->lastReaderLevel : t->writerLevel;
+        }
+    }
+    qsort(lifetimes, count, sizeof(Lifetime), compareLifetimes);
+
+    /* greedy interval coloring: processing by begin level and reusing any free
+     * block gives the minimal number of blocks */
+    bool ok = true;
+    async_mutex_lock(&udata->processMutex);
+    {
+        if (++udata->storageGeneration <= 0) {
+            udata->storageGeneration = 1;
+        }
+        list->storageGeneration = udata->storageGeneration;
+        list->procBufCount      = count;
+
+        for (int b = 0; b < udata->sharedBlockCount; ++b) {
+            udata->sharedBlocks[b]->busyUntil = INT_MIN;
+        }
+        for (int i = 0; i < count; ++i) {
+            Lifetime*    t       = lifetimes + i;
+            bool         isAudio = t->procBuf->isAudio;
+            SharedBlock* block   = NULL;
+            for (int b = 0; b < udata->sharedBlockCount; ++b) {
+                SharedBlock* bl = udata->sharedBlocks[b];
+                if (bl->isAudio == isAudio && bl->busyUntil < t->begin) {
+                    block = bl;
+                    break;
+                }
+            }
+            if (!block) {
+                block = newBlock_LOCKED(udata, isAudio);
+                if (!block) {
+                    ok = false;
+                    break;
+                }
+            }
+            block->busyUntil  = t->end;
+            block->generation = list->storageGeneration;
+            list->procBufs[i]      = t->procBuf;
+            list->procBufBlocks[i] = block;
+        }
+    }
+    async_mutex_unlock(&udata->processMutex);
+
+    free(lifetimes);
+    if (!ok) {
+        free(list->procBufs);
+        list->procBufs     = NULL;
+        list->procBufCount = 0;
+    }
+    return ok;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_storage_apply(ClientUserData* udata, LjackExecList* list)
+{
+    if (list->storageGeneration != udata->appliedStorageGeneration) {
+        for (int i = 0; i < list->procBufCount; ++i) {
+            ProcBufUserData* procBuf = list->procBufs[i];
+            procBuf->buffer = list->procBufBlocks[i]->buffer;
+            if (procBuf->isMidi) {
+                ljack_procbuf_clear_midi_events(procBuf);
+            }
+        }
+        udata->appliedStorageGeneration = list->storageGeneration;
+    }
+}
+
+/* ============================================================================================ */
+
+static bool hasOwnStorage(LjackConnectorInfo* info)
+{
+    return info->isProcBuf && info->procBufUdata->arenaSlot >= 0;
+}
+
+static int collectLayout(LjackExecList* list, bool isAudio, int n, char*** owners, int* slots)
+{
+    for (int k = 0; k < list->procCount; ++k) {
+        LjackProcReg* reg = list->procList[k];
+        for (int i = 0; i < reg->connectorCount; ++i) {
+            LjackConnectorInfo* info    = reg->connectorInfos + i;
+            ProcBufUserData*    procBuf = info->procBufUdata;
+            if (hasOwnStorage(info) && procBuf->isAudio == isAudio && procBuf->storageIndex < 0) {
+                procBuf->storageIndex = n;
+                list->layoutProcBufs[n] = procBuf;
+                owners[n]               = &procBuf->buffer;
+                slots[n]                = procBuf->arenaSlot;
+                ++n;
+            }
+        }
+    }
+    return n;
+}
+
+bool ljack_client_storage_layout(ClientUserData* udata, LjackExecList* list)
+{
+    int count = 0;
+    for (int k = 0; k < list->procCount; ++k) {
+        LjackProcReg* reg = list->procList[k];
+        for (int i = 0; i < reg->connectorCount; ++i) {
+            if (hasOwnStorage(reg->connectorInfos + i)) {
+                reg->connectorInfos[i].procBufUdata->storageIndex = -1;
+                ++count;
+            }
+        }
+    }
+    if (count == 0) {
+        return true;
+    }
+    list->layoutProcBufs = malloc(count * (sizeof(ProcBufUserData*) + sizeof(char*) + sizeof(char**) 
+                                           + sizeof(int)));
+    if (!list->layoutProcBufs) {
+        return false;
+    }
+    list->layoutBuffers = (char**)(list->layoutProcBufs + count);
+    char*** owners      = (char***)(list->layoutBuffers + count);
+    int*    slots       = (int*)(owners + count);
+    
+    int audioCount = collectLayout(list, true,  0,          owners, slots);
+    int totalCount = collectLayout(list, false, audioCount, owners, slots);
+    
+    async_mutex_lock(&udata->processMutex);
+    {
+        ljack_arena_reorder_LOCKED(&udata->arena, true,  audioCount, 
+                                   owners, slots, list->layoutBuffers);
+        ljack_arena_reorder_LOCKED(&udata->arena, false, totalCount - audioCount, 
+                                   owners + audioCount, slots + audioCount, list->layoutBuffers + audioCount);
+        for (int i = 0; i < totalCount; ++i) {
+            list->layoutProcBufs[i]->arenaSlot = slots[i];
+        }
+        list->layoutCount      = totalCount;
+        list->layoutGeneration = ++udata->layoutGeneration;
+    }
+    async_mutex_unlock(&udata->processMutex);
+    return true;
+}
+
+/**
+ * Exec lists that were created before the last buffer size change have older
+ * generations, their addresses refer to replaced arena chunks.
+ */
+void ljack_client_storage_apply_layout(ClientUserData* udata, LjackExecList* list)
+{
+    if (list->layoutGeneration > udata->appliedLayoutGeneration) {
+        for (int i = 0; i < list->layoutCount; ++i) {
+            ProcBufUserData* procBuf = list->layoutProcBufs[i];
+            if (procBuf->buffer != list->layoutBuffers[i]) {
+                procBuf->buffer      = list->layoutBuffers[i];
+                procBuf->silentCycle = 0;
+                if (procBuf->isMidi) {
+                    ljack_procbuf_clear_midi_events(procBuf);
+                }
+            }
+        }
+        udata->appliedLayoutGeneration = list->layoutGeneration;
+    }
+}
+
+/* ============================================================================================ */
+
+void ljack_client_storage_trim(ClientUserData* udata, LjackExecList* list)
+{
+    int generation = list ? list->storageGeneration : 0;
+    async_mutex_lock(&udata->processMutex);
+    {
+        int n = 0;
+        for (int b = 0; b < udata->sharedBlockCount; ++b) {
+            SharedBlock* block = udata->sharedBlocks[b];
+            if (block->generation == generation && generation != 0) {
+                udata->sharedBlocks[n++] = block;
+            } else {
+                freeBlock_LOCKED(udata, block);
+            }
+        }
+        udata->sharedBlockCount = n;
+    }
+    async_mutex_unlock(&udata->processMutex);
+}
+
+/* ============================================================================================ */
+
+void ljack_client_storage_free(ClientUserData* udata)
+{
+    for (int b = 0; b < udata->sharedBlockCount; ++b) {
+        freeBlock_LOCKED(udata, udata->sharedBlocks[b]);
+    }
+    free(udata->sharedBlocks);
+    udata->sharedBlocks        = NULL;
+    udata->sharedBlockCount    = 0;
+    udata->sharedBlockCapacity = 0;
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,73 @@
+#ifndef LJACK_CLIENT_STORAGE_H
+#define LJACK_CLIENT_STORAGE_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Shared storage for process buffers (client option "share_process_buffers").
+ *
+ * The lifetime of a process buffer within one process cycle reaches from the
+ * level of its writer to the last level of its readers in the exec list. Process
+ * buffers with non-overlapping lifetimes are assigned to the same storage block.
+ * The assignment is part of the exec list and is applied by the process thread
+ * at the beginning of the first cycle that runs the new exec list.
+ */
+
+typedef struct LjackClientUserData   LjackClientUserData;
+typedef struct LjackExecList         LjackExecList;
+typedef struct LjackSharedBlock      LjackSharedBlock;
+
+struct LjackSharedBlock
+{
+    bool               isAudio;
+    char*              buffer;            /* storage in the client's arena */
+    int                arenaSlot;
+    int                busyUntil;         /* only used while assigning */
+    int                generation;        /* generation of the newest exec list using this block */
+};
+
+/**
+ * Assigns storage blocks to all process buffers used in the exec list. Is called
+ * on the Lua thread before the exec list is published.
+ *
+ * Returns false if memory could not be allocated.
+ */
+bool ljack_client_storage_assign(LjackClientUserData* udata, LjackExecList* list);
+
+/**
+ * Lets the process buffers of the exec list use their assigned storage.
+ * Is called in the process thread.
+ */
+void ljack_client_storage_apply(LjackClientUserData* udata, LjackExecList* list);
+
+/**
+ * Process buffers with storage of their own keep the arena slots they got on 
+ * creation. For every new exec list these slots are reassigned to the process
+ * buffers in execution order. Is called on the Lua thread before the exec list 
+ * is published.
+ *
+ * Returns false if memory could not be allocated.
+ */
+bool ljack_client_storage_layout(LjackClientUserData* udata, LjackExecList* list);
+
+/**
+ * Lets the process buffers of the exec list use the storage of their reassigned 
+ * arena slots. Is called in the process thread.
+ */
+void ljack_client_storage_apply_layout(LjackClientUserData* udata, LjackExecList* list);
+
+/**
+ * Frees storage blocks that are not used by the given exec list. Must only be
+ * called if there are no retired exec lists.
+ */
+void ljack_client_storage_trim(LjackClientUserData* udata, LjackExecList* list);
+
+void ljack_client_storage_free(LjackClientUserData* udata);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_STORAGE_H */
@@ -0,0 +1,153 @@
+#include <jack/jack.h>
+#include <jack/thread.h>
+#include <jack/ringbuffer.h>
+
+#include "util.h"
+#include "receiver_capi.h"
+
+#include "client_intern.h"
+#include "client_workers.h"
+#include "main.h"
+
+/* ============================================================================================ */
+
+struct LjackClientWorkers
+{
+    LjackClientUserData*  udata;
+    
+    int                   threadCount;
+    int                   startedCount;
+    jack_native_thread_t* threads;
+
+    Semaphore             startSemaphore;
+    Semaphore             doneSemaphore;
+    AtomicCounter         shouldTerminate;
+
+    /* current job, set by the JACK process thread before waking workers */
+    LjackProcReg**        procList;
+    bool*                 activated;
+    int                   procCount;
+    jack_nframes_t        nframes;
+    AtomicCounter         nextIndex;
+    AtomicPtr             failedReg;
+    int                   failedRc;
+};
+
+/* ============================================================================================ */
+
+static void runJobs(LjackClientWorkers* w)
+{
+    while (true) {
+        int i = atomic_inc(&w->nextIndex) - 1;
+        if (i >= w->procCount) {
+            break;
+        }
+        LjackProcReg* reg = w->procList[i];
+        int rc = ljack_client_intern_run_processor(w->udata, reg, w->activated[i], w->nframes);
+        if (rc != 0) {
+            if (atomic_set_ptr_if_equal(&w->failedReg, NULL, reg)) {
+                w->failedRc = rc;
+            }
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+static void* workerThread(void* arg)
+{
+    LjackClientWorkers* w = arg;
+    ljack_client_intern_mark_processing_thread();
+    while (true) {
+        async_semaphore_wait(&w->startSemaphore);
+        if (atomic_get(&w->shouldTerminate)) {
+            break;
+        }
+        runJobs(w);
+        async_semaphore_post(&w->doneSemaphore);
+    }
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+LjackClientWorkers* ljack_client_workers_start(LjackClientUserData* udata, int threadCount)
+{
+    LjackClientWorkers*   w       = calloc(1, sizeof(LjackClientWorkers));
+    jack_native_thread_t* threads = calloc(threadCount, sizeof(jack_native_thread_t));
+    if (!w || !threads) {
+        if (w)       free(w);
+        if (threads) free(threads);
+        return NULL;
+    }
+    w->udata       = udata;
+    w->threadCount = threadCount;
+    w->threads     = threads;
+    async_semaphore_init(&w->startSemaphore);
+    async_semaphore_init(&w->doneSemaphore);
+
+    jack_client_t* client   = udata->client;
+    int            priority = jack_client_real_time_priority(client);
+    int            realtime = jack_is_realtime(client);
+    
+    for (int i = 0; i < threadCount; ++i) {
+        int rc = jack_client_create_thread(client, &threads[i], priority, realtime, 
+                                           workerThread, w);
+        if (rc != 0) {
+            ljack_log_error("LJACK: cannot create worker thread (error %d).", rc);
+            ljack_client_workers_stop(w);
+            return NULL;
+        }
+        w->startedCount += 1;
+    }
+    return w;
+}
+
+/* ============================================================================================ */
+
+void ljack_client_workers_stop(LjackClientWorkers* w)
+{
+    atomic_set(&w->shouldTerminate, 1);
+    for (int i = 0; i < w->startedCount; ++i) {
+        async_semaphore_post(&w->startSemaphore);
+    }
+    for (int i = 0; i < w->startedCount; ++i) {
+        jack_client_stop_thread(w->udata->client, w->threads[i]);
+    }
+    async_semaphore_destruct(&w->startSemaphore);
+    async_semaphore_destruct(&w->doneSemaphore);
+    free(w->threads);
+    free(w);
+}
+
+/* ============================================================================================ */
+
+int ljack_client_workers_run(LjackClientWorkers* w, 
+                             LjackProcReg** procList, bool* activated, int procCount,
+                             jack_nframes_t nframes,
+                             LjackProcReg** failedReg)
+{
+    w->procList  = procList;
+    w->activated = activated;
+    w->procCount = procCount;
+    w->nframes   = nframes;
+    w->failedRc  = 0;
+    atomic_set(&w->nextIndex, 0);
+    atomic_set_ptr(&w->failedReg, NULL);
+
+    int helpers = procCount - 1;
+    if (helpers > w->threadCount) {
+        helpers = w->threadCount;
+    }
+    for (int i = 0; i < helpers; ++i) {
+        async_semaphore_post(&w->startSemaphore);
+    }
+    runJobs(w);
+    for (int i = 0; i < helpers; ++i) {
+        async_semaphore_wait(&w->doneSemaphore);
+    }
+    *failedReg = atomic_get_ptr(&w->failedReg);
+    return w->failedRc;
+}
+
+/* ============================================================================================ */
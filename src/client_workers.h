@@ -0,0 +1,40 @@
+#ifndef LJACK_CLIENT_WORKERS_H
+#define LJACK_CLIENT_WORKERS_H
+
+#include <jack/jack.h>
+
+#include "util.h"
+
+/* ============================================================================================ */
+
+/**
+ * Pool of additional realtime threads that run independent processors of
+ * one dependency level in parallel to the JACK process thread.
+ */
+
+#define LJACK_MAX_WORKER_THREADS 256
+
+typedef struct LjackClientUserData LjackClientUserData;
+typedef struct LjackProcReg        LjackProcReg;
+typedef struct LjackClientWorkers  LjackClientWorkers;
+
+LjackClientWorkers* ljack_client_workers_start(LjackClientUserData* udata, int threadCount);
+
+void ljack_client_workers_stop(LjackClientWorkers* workers);
+
+/**
+ * Runs all processors of the given list and returns after all processors have
+ * finished. Is called from the JACK process thread which participates in running
+ * the processors.
+ * 
+ * Returns 0 or the error code of the first failing processor, which is
+ * stored in *failedReg.
+ */
+int ljack_client_workers_run(LjackClientWorkers* workers, 
+                             LjackProcReg** procList, bool* activated, int procCount,
+                             jack_nframes_t nframes,
+                             LjackProcReg** failedReg);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_CLIENT_WORKERS_H */
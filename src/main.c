@@ -8,9 +8,12 @@
 #include "client.h"
 #include "port.h"
 #include "procbuf.h"
+#include "matrix_mixer.h"
 #include "receiver_capi.h"
 #include "error.h"
 #include "auproc_capi_impl.h"
+#include "audio_kernels.h"
+#include "status_codes.h"
 
 
 
@@ -359,12 +362,15 @@ DLL_PUBLIC int luaopen_ljack(lua_State* L)
     ljack_client_init_module         (L, module);
     ljack_port_init_module           (L, module);
     ljack_procbuf_init_module        (L, module);
+    ljack_matrix_mixer_init_module   (L, module);
+    ljack_status_codes_init_module   (L, module);
 
     lua_newtable(L);                                   /* -> meta */
     lua_pushstring(L, "ljack");                        /* -> meta, "ljack" */
     lua_setfield(L, -2, "__metatable");                /* -> meta */
     lua_pushstring(L, "ljack");                        /* -> meta, "ljack" */
     lua_setfield(L, -2, "__name");                     /* -> meta */
+    ljack_audio_kernels_init();
     auproc_set_capi(L, -1, &auproc_capi_impl);         /* -> meta */
     lua_setmetatable(L, module);                       /* -> */
     
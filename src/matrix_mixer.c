@@ -0,0 +1,413 @@
+#include <jack/jack.h>
+
+#include "util.h"
+
+#include "auproc_capi_impl.h"
+#include "audio_kernels.h"
+#include "matrix_mixer.h"
+
+const char* const LJACK_MATRIX_MIXER_CLASS_NAME = "ljack.matrix_mixer";
+
+static const char* const LJACK_ERROR_INVALID_MATRIX_MIXER = "invalid matrix mixer";
+
+/* ============================================================================================ */
+
+/**
+ * Processor data, is allocated separately from the Lua object since it has to
+ * live until the engine is released if the Lua object is garbage collected
+ * while the engine is closed.
+ */
+typedef struct MixerData
+{
+    auproc_engine*     engine;
+    auproc_processor*  processor;
+    bool               closed;
+    bool               luaObjectGone;
+
+    int                inputCount;
+    int                outputCount;
+    auproc_con_reg*    conRegs;       /* inputCount inputs followed by outputCount outputs */
+    const float**      inputBuffers;  /* only used in processCallback, NULL for silent inputs */
+
+    /* gain of input i for output j at index j * inputCount + i, stored as float bits
+     * to be updated lock-free from the Lua thread */
+    AtomicCounter*     gains;
+} MixerData;
+
+typedef struct MatrixMixerUserData
+{
+    MixerData*         data;
+} MatrixMixerUserData;
+
+/* ============================================================================================ */
+
+static int floatToBits(float f)
+{
+    int rslt;
+    memcpy(&rslt, &f, sizeof(int));
+    return rslt;
+}
+
+static float bitsToFloat(int bits)
+{
+    float rslt;
+    memcpy(&rslt, &bits, sizeof(float));
+    return rslt;
+}
+
+/* ============================================================================================ */
+
+static void freeMixerData(MixerData* data)
+{
+    free(data->conRegs);
+    free(data->inputBuffers);
+    free(data->gains);
+    free(data);
+}
+
+/* ============================================================================================ */
+
+static int processCallback(uint32_t nframes, void* processorData)
+{
+    MixerData*                 data    = processorData;
+    const auproc_audiokernels* kernels = &ljack_audio_kernels;
+    const int                  n       = data->inputCount;
+
+    for (int i = 0; i < n; ++i) {
+        auproc_con_reg* reg = data->conRegs + i;
+        if (reg->audioMethods->isSilent(reg->connector, nframes)) {
+            data->inputBuffers[i] = NULL;
+        } else {
+            data->inputBuffers[i] = reg->audioMethods->getAudioBuffer(reg->connector, nframes);
+        }
+    }
+    for (int j = 0; j < data->outputCount; ++j) {
+        auproc_con_reg* reg   = data->conRegs + n + j;
+        AtomicCounter*  gains = data->gains + j * n;
+        float*          out   = NULL;
+        for (int i = 0; i < n; ++i) {
+            float g = bitsToFloat(atomic_get(gains + i));
+            if (g != 0 && data->inputBuffers[i]) {
+                if (!out) {
+                    out = reg->audioMethods->getAudioBuffer(reg->connector, nframes);
+                    kernels->gain(out, data->inputBuffers[i], g, nframes);
+                } else {
+                    kernels->mixAdd(out, data->inputBuffers[i], g, nframes);
+                }
+            }
+        }
+        if (!out) {
+            reg->audioMethods->setSilent(reg->connector, nframes);
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static void engineClosedCallback(void* processorData)
+{
+    MixerData* data = processorData;
+    data->closed = true;
+}
+
+/* ============================================================================================ */
+
+static void engineReleasedCallback(void* processorData)
+{
+    MixerData* data = processorData;
+    data->closed    = true;
+    data->processor = NULL;
+    data->engine    = NULL;
+    if (data->luaObjectGone) {
+        freeMixerData(data);
+    }
+}
+
+/* ============================================================================================ */
+
+static void setupMatrixMixerMeta(lua_State* L);
+
+static int pushMatrixMixerMeta(lua_State* L)
+{
+    if (luaL_newmetatable(L, LJACK_MATRIX_MIXER_CLASS_NAME)) {
+        setupMatrixMixerMeta(L);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static void checkConnectorTable(lua_State* L, int arg, int* count)
+{
+    luaL_checktype(L, arg, LUA_TTABLE);
+    *count = lua_rawlen(L, arg);
+    for (int i = 1; i <= *count; ++i) {
+        lua_rawgeti(L, arg, i);
+        if (auproc_capi_impl.getConnectorType(L, -1) != AUPROC_AUDIO) {
+            luaL_argerror(L, arg, lua_pushfstring(L, "AUDIO connector expected at index %d", i));
+        }
+        lua_pop(L, 1);
+    }
+}
+
+static int regErrorToLuaError(lua_State* L, auproc_con_reg_err* regError, int inputCount)
+{
+    if (regError->conIndex < 0) {
+        return luaL_error(L, "cannot register matrix mixer (error %d)", (int)regError->errorType);
+    }
+    const char* what;
+    switch (regError->errorType) {
+        case AUPROC_REG_ERR_CONNCTOR_INVALID:     what = "connector is invalid"; break;
+        case AUPROC_REG_ERR_ENGINE_MISMATCH:      what = "connector belongs to other client"; break;
+        case AUPROC_REG_ERR_WRONG_DIRECTION:      what = "connector cannot be used in this direction"; break;
+        case AUPROC_REG_ERR_WRONG_CONNECTOR_TYPE: what = "AUDIO connector expected"; break;
+        default:                                  what = "invalid connector"; break;
+    }
+    int i = regError->conIndex;
+    if (i < inputCount) {
+        return luaL_error(L, "%s (input %d)", what, i + 1);
+    } else {
+        return luaL_error(L, "%s (output %d)", what, i - inputCount + 1);
+    }
+}
+
+int ljack_matrix_mixer_new(lua_State* L, int clientArg, int inputsArg, int outputsArg)
+{
+    int inputCount, outputCount;
+    checkConnectorTable(L, inputsArg,  &inputCount);
+    checkConnectorTable(L, outputsArg, &outputCount);
+    if (inputCount + outputCount > 0xffff) {
+        return luaL_error(L, "too many connectors");
+    }
+    auproc_engine* engine = auproc_capi_impl.getEngine(L, clientArg, NULL);
+    if (!engine) {
+        return luaL_argerror(L, clientArg, "client expected");
+    }
+
+    MatrixMixerUserData* udata = lua_newuserdata(L, sizeof(MatrixMixerUserData));
+    memset(udata, 0, sizeof(MatrixMixerUserData));   /* -> udata */
+    pushMatrixMixerMeta(L);                           /* -> udata, meta */
+    lua_setmetatable(L, -2);                          /* -> udata */
+
+    int        connectorCount = inputCount + outputCount;
+    MixerData* data           = calloc(1, sizeof(MixerData));
+    if (data) {
+        udata->data        = data;
+        data->inputCount   = inputCount;
+        data->outputCount  = outputCount;
+        data->conRegs      = calloc(connectorCount + 1,             sizeof(auproc_con_reg));
+        data->inputBuffers = calloc(inputCount + 1,                 sizeof(float*));
+        data->gains        = calloc(inputCount * outputCount + 1,   sizeof(AtomicCounter));
+    }
+    if (!data || !data->conRegs || !data->inputBuffers || !data->gains) {
+        return luaL_error(L, "out of memory");
+    }
+    for (int i = 0; i < inputCount * outputCount; ++i) {
+        atomic_set(data->gains + i, floatToBits(0.0f));
+    }
+    int firstConnectorIndex = lua_gettop(L) + 1;
+    luaL_checkstack(L, connectorCount, NULL);
+    for (int i = 0; i < connectorCount; ++i) {
+        bool isInput = (i < inputCount);
+        lua_rawgeti(L, isInput ? inputsArg : outputsArg, isInput ? i + 1 : i - inputCount + 1);
+        data->conRegs[i].conType      = AUPROC_AUDIO;
+        data->conRegs[i].conDirection = isInput ? AUPROC_IN : AUPROC_OUT;
+    }
+    const char* processorName = lua_pushfstring(L, "%s: %p", LJACK_MATRIX_MIXER_CLASS_NAME, udata);
+
+    auproc_con_reg_err regError = {0};
+    auproc_processor*  processor = auproc_capi_impl.registerProcessor(L, firstConnectorIndex, connectorCount,
+                                                                      engine, processorName, data,
+                                                                      processCallback, NULL,
+                                                                      engineClosedCallback,
+                                                                      engineReleasedCallback,
+                                                                      data->conRegs, &regError);
+    if (!processor) {
+        return regErrorToLuaError(L, &regError, inputCount);
+    }
+    data->engine    = engine;
+    data->processor = processor;
+    auproc_capi_impl.setProcessorFlags(L, engine, processor, AUPROC_PROC_SILENT_IF_INPUTS_SILENT);
+
+    lua_settop(L, firstConnectorIndex - 1);           /* -> udata */
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static MixerData* checkMixerData(lua_State* L, int arg)
+{
+    MatrixMixerUserData* udata = luaL_checkudata(L, arg, LJACK_MATRIX_MIXER_CLASS_NAME);
+    MixerData*           data  = udata->data;
+    if (!data || !data->processor) {
+        luaL_error(L, LJACK_ERROR_INVALID_MATRIX_MIXER);
+        return NULL;
+    }
+    if (data->closed || auproc_capi_impl.isEngineClosed(data->engine)) {
+        data->closed = true;
+        luaL_error(L, "%s: client was closed", LJACK_ERROR_INVALID_MATRIX_MIXER);
+        return NULL;
+    }
+    return data;
+}
+
+static AtomicCounter* checkGain(lua_State* L, MixerData* data, int arg)
+{
+    lua_Integer i = luaL_checkinteger(L, arg);
+    lua_Integer j = luaL_checkinteger(L, arg + 1);
+    luaL_argcheck(L, 1 <= i && i <= data->inputCount,  arg,     "input index out of range");
+    luaL_argcheck(L, 1 <= j && j <= data->outputCount, arg + 1, "output index out of range");
+    return data->gains + (j - 1) * data->inputCount + (i - 1);
+}
+
+/* ============================================================================================ */
+
+static int unregisterInProtectedMode(lua_State* L)
+{
+    MixerData* data = lua_touserdata(L, 1);
+    auproc_capi_impl.unregisterProcessor(L, data->engine, data->processor);
+    data->processor = NULL;
+    return 0;
+}
+
+static int LjackMatrixMixer_release(lua_State* L)
+{
+    MatrixMixerUserData* udata = luaL_checkudata(L, 1, LJACK_MATRIX_MIXER_CLASS_NAME);
+    MixerData*           data  = udata->data;
+    if (data) {
+        udata->data = NULL;
+        if (data->processor && !data->closed && !auproc_capi_impl.isEngineClosed(data->engine)) {
+            lua_pushcfunction(L, unregisterInProtectedMode);
+            lua_pushlightuserdata(L, data);
+            if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+                auproc_capi_impl.logError(data->engine, "LJACK: cannot unregister garbage collected matrix mixer: %s",
+                                          lua_tostring(L, -1));
+                lua_pop(L, 1);
+            }
+        }
+        if (data->processor) {
+            /* processor is still registered, data is freed in engineReleasedCallback */
+            data->luaObjectGone = true;
+        } else {
+            freeMixerData(data);
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_toString(lua_State* L)
+{
+    MatrixMixerUserData* udata = luaL_checkudata(L, 1, LJACK_MATRIX_MIXER_CLASS_NAME);
+    lua_pushfstring(L, "%s: %p", LJACK_MATRIX_MIXER_CLASS_NAME, udata);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_activate(lua_State* L)
+{
+    MixerData* data = checkMixerData(L, 1);
+    auproc_capi_impl.activateProcessor(L, data->engine, data->processor);
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_deactivate(lua_State* L)
+{
+    MixerData* data = checkMixerData(L, 1);
+    auproc_capi_impl.deactivateProcessor(L, data->engine, data->processor);
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_unregister(lua_State* L)
+{
+    MixerData* data = checkMixerData(L, 1);
+    auproc_capi_impl.unregisterProcessor(L, data->engine, data->processor);
+    data->processor = NULL;
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_set_gain(lua_State* L)
+{
+    MixerData*     data = checkMixerData(L, 1);
+    AtomicCounter* gain = checkGain(L, data, 2);
+    float          g    = (float) luaL_checknumber(L, 4);
+    atomic_set(gain, floatToBits(g));
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_get_gain(lua_State* L)
+{
+    MixerData*     data = checkMixerData(L, 1);
+    AtomicCounter* gain = checkGain(L, data, 2);
+    lua_pushnumber(L, bitsToFloat(atomic_get(gain)));
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int LjackMatrixMixer_get_size(lua_State* L)
+{
+    MixerData* data = checkMixerData(L, 1);
+    lua_pushinteger(L, data->inputCount);
+    lua_pushinteger(L, data->outputCount);
+    return 2;
+}
+
+/* ============================================================================================ */
+
+static const luaL_Reg LjackMatrixMixerMethods[] =
+{
+    { "activate",    LjackMatrixMixer_activate   },
+    { "deactivate",  LjackMatrixMixer_deactivate },
+    { "unregister",  LjackMatrixMixer_unregister },
+    { "set_gain",    LjackMatrixMixer_set_gain   },
+    { "get_gain",    LjackMatrixMixer_get_gain   },
+    { "get_size",    LjackMatrixMixer_get_size   },
+    { NULL,          NULL } /* sentinel */
+};
+
+static const luaL_Reg LjackMatrixMixerMetaMethods[] =
+{
+    { "__tostring", LjackMatrixMixer_toString },
+    { "__gc",       LjackMatrixMixer_release  },
+
+    { NULL,       NULL } /* sentinel */
+};
+
+/* ============================================================================================ */
+
+static void setupMatrixMixerMeta(lua_State* L)
+{                                                       /* -> meta */
+    lua_pushstring(L, LJACK_MATRIX_MIXER_CLASS_NAME);   /* -> meta, className */
+    lua_setfield(L, -2, "__metatable");                 /* -> meta */
+
+    luaL_setfuncs(L, LjackMatrixMixerMetaMethods, 0);   /* -> meta */
+
+    lua_newtable(L);                                    /* -> meta, MatrixMixerClass */
+    luaL_setfuncs(L, LjackMatrixMixerMethods, 0);       /* -> meta, MatrixMixerClass */
+    lua_setfield (L, -2, "__index");                    /* -> meta */
+}
+
+/* ============================================================================================ */
+
+int ljack_matrix_mixer_init_module(lua_State* L, int module)
+{
+    if (luaL_newmetatable(L, LJACK_MATRIX_MIXER_CLASS_NAME)) {
+        setupMatrixMixerMeta(L);
+    }
+    lua_pop(L, 1);
+    return 0;
+}
+
+/* ============================================================================================ */
@@ -0,0 +1,22 @@
+#ifndef LJACK_MATRIX_MIXER_H
+#define LJACK_MATRIX_MIXER_H
+
+#include "util.h"
+
+extern const char* const LJACK_MATRIX_MIXER_CLASS_NAME;
+
+/* ============================================================================================ */
+
+/**
+ * Creates a native processor that mixes the audio connectors given in the table
+ * at inputsArg into the audio connectors given in the table at outputsArg.
+ * The client or engine object must be at stack index clientArg.
+ * Pushes the new matrix mixer object onto the stack.
+ */
+int ljack_matrix_mixer_new(lua_State* L, int clientArg, int inputsArg, int outputsArg);
+
+int ljack_matrix_mixer_init_module(lua_State* L, int module);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_MATRIX_MIXER_H */
@@ -0,0 +1,105 @@
+#include "util.h"
+#include "midi_merge.h"
+
+/* ============================================================================================ */
+
+typedef struct MergeInput
+{
+    auproc_midi_event      event;   /* next event of this input */
+    auproc_midibuf*        midibuf;
+    const auproc_midimeth* midiMethods;
+    uint32_t               index;   /* index of the next event */
+    uint32_t               count;
+    int                    order;   /* position in the input list, for events with equal time */
+} MergeInput;
+
+static bool isBefore(const MergeInput* a, const MergeInput* b)
+{
+    return a->event.time < b->event.time || (a->event.time == b->event.time && a->order < b->order);
+}
+
+static void siftDown(MergeInput* heap, int n, int i)
+{
+    MergeInput entry = heap[i];
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && isBefore(&heap[child + 1], &heap[child])) {
+            child += 1;
+        }
+        if (!isBefore(&heap[child], &entry)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+}
+
+static bool readNextEvent(MergeInput* input)
+{
+    while (input->index < input->count) {
+        int rc = input->midiMethods->getMidiEvent(&input->event, input->midibuf, input->index++);
+        if (rc == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ============================================================================================ */
+
+/**
+ * The inputs are kept in a binary min heap ordered by the time of their next event,
+ * i.e. each event costs O(log inCount) instead of sorting all events.
+ */
+int ljack_midi_merge(auproc_midibuf*               outBuf, 
+                     const auproc_midimeth*        outMethods,
+                     auproc_midibuf* const*        inBufs,
+                     const auproc_midimeth* const* inMethods,
+                     int                           inCount)
+{
+    if (inCount < 0 || inCount > LJACK_MIDI_MERGE_MAX_INPUTS) {
+        return -1;
+    }
+    MergeInput heap[LJACK_MIDI_MERGE_MAX_INPUTS];
+    int        n = 0;
+    
+    for (int i = 0; i < inCount; ++i) {
+        MergeInput* input  = heap + n;
+        input->midibuf     = inBufs[i];
+        input->midiMethods = inMethods[i];
+        input->index       = 0;
+        input->count       = inMethods[i]->getEventCount(inBufs[i]);
+        input->order       = i;
+        if (readNextEvent(input)) {
+            n += 1;
+        }
+    }
+    outMethods->clearBuffer(outBuf);
+    
+    for (int i = n / 2 - 1; i >= 0; --i) {
+        siftDown(heap, n, i);
+    }
+    int dropped = 0;
+    while (n > 0) {
+        MergeInput*    input = heap;
+        unsigned char* data  = outMethods->reserveMidiEvent(outBuf, input->event.time, input->event.size);
+        if (data) {
+            memcpy(data, input->event.buffer, input->event.size);
+        } else {
+            dropped += 1;
+        }
+        if (!readNextEvent(input)) {
+            heap[0] = heap[--n];
+        }
+        if (n > 0) {
+            siftDown(heap, n, 0);
+        }
+    }
+    return dropped;
+}
+
+/* ============================================================================================ */
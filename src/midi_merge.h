@@ -0,0 +1,23 @@
+#ifndef LJACK_MIDI_MERGE_H
+#define LJACK_MIDI_MERGE_H
+
+#include "util.h"
+#include "auproc_capi.h"
+
+/* ============================================================================================ */
+
+#define LJACK_MIDI_MERGE_MAX_INPUTS 256
+
+/**
+ * Merges the events of the input MIDI buffers in time order into the output MIDI
+ * buffer, see mergeMidiEvents in auproc_capi.h. May be called from the process thread.
+ */
+int ljack_midi_merge(auproc_midibuf*               outBuf, 
+                     const auproc_midimeth*        outMethods,
+                     auproc_midibuf* const*        inBufs,
+                     const auproc_midimeth* const* inMethods,
+                     int                           inCount);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_MIDI_MERGE_H */
@@ -332,6 +332,29 @@ static int LjackPort_get_connections(lua_State* L)
 
 /* ============================================================================================ */
 
+static int LjackPort_get_latency_range(lua_State* L)
+{
+    int arg = 1;
+    PortUserData* udata = checkPortUdata(L, arg++);
+    const char*   mode  = luaL_checkstring(L, arg++);
+
+    jack_latency_callback_mode_t m;
+    if (strcmp(mode, "capture") == 0) {
+        m = JackCaptureLatency;
+    } else if (strcmp(mode, "playback") == 0) {
+        m = JackPlaybackLatency;
+    } else {
+        return luaL_argerror(L, 2, "\"capture\" or \"playback\" expected");
+    }
+    jack_latency_range_t range;
+    jack_port_get_latency_range(udata->port, m, &range);
+    lua_pushinteger(L, range.min);
+    lua_pushinteger(L, range.max);
+    return 2;
+}
+
+/* ============================================================================================ */
+
 const char* ljack_port_name_from_arg(lua_State* L, int arg)
 {
     if (lua_type(L, arg) == LUA_TSTRING) {
@@ -434,6 +457,7 @@ static const luaL_Reg LjackPortMethods[] =
     { "connect",          LjackPort_connect         },
     { "disconnect",       LjackPort_disconnect      },
     { "connected_to",     LjackPort_connected_to    },
+    { "get_latency_range", LjackPort_get_latency_range },
     { NULL,          NULL } /* sentinel */
 };
 
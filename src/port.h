@@ -24,6 +24,11 @@ typedef struct LjackPortUserData
     bool                 isAudio;
     
     int              procUsageCounter;
+    uint32_t         silentCycle;        /* process cycle in which the buffer was marked as silent */
+    
+    jack_latency_range_t latencyRange;   /* only used in the latency callback */
+    bool                 latencyValid;
+    
     AtomicCounter*   shutdownReceived;
     
     struct LjackClientUserData* clientUserData;
@@ -7,7 +7,11 @@
 #define AUPROC_CAPI_IMPLEMENT_SET_CAPI 1
 #include "auproc_capi_impl.h"
 
+#include "receiver_capi.h"
 #include "procbuf.h"
+#include "port.h"
+#include "client_intern.h"
+#include "midi_merge.h"
 
 /* ============================================================================================ */
 
@@ -23,9 +27,9 @@ typedef struct LjackClientUserData    ClientUserData;
 void ljack_procbuf_clear_midi_events(LjackProcBufUserData* udata)
 {
     udata->midiEventCount  = 0;
-    if (udata->ringBuffer) {
-        udata->midiEventsBegin = (jack_midi_event_t*)udata->ringBuffer->buf;
-        udata->midiDataBegin   = udata->ringBuffer->buf + udata->ringBuffer->size;
+    if (udata->buffer) {
+        udata->midiEventsBegin = (jack_midi_event_t*)udata->buffer;
+        udata->midiDataBegin   = (jack_midi_data_t*)udata->buffer + udata->bufferLength;
     } else {
         udata->midiEventsBegin = NULL;
         udata->midiDataBegin   = NULL;
@@ -58,6 +62,49 @@ int ljack_procbuf_get_midi_event(jack_midi_event_t*  event,
 
 /* ============================================================================================ */
 
+const jack_midi_event_t* ljack_procbuf_get_midi_event_array(LjackProcBufUserData* udata,
+                                                            uint32_t*             count)
+{
+    *count = udata->midiEventCount;
+    return udata->midiEventsBegin;
+}
+
+/* ============================================================================================ */
+
+uint32_t ljack_procbuf_get_midi_events(jack_midi_event_t*    events,
+                                       LjackProcBufUserData* udata,
+                                       uint32_t              firstIndex,
+                                       uint32_t              maxCount)
+{
+    if (firstIndex >= udata->midiEventCount) {
+        return 0;
+    }
+    uint32_t n = udata->midiEventCount - firstIndex;
+    if (n > maxCount) {
+        n = maxCount;
+    }
+    memcpy(events, udata->midiEventsBegin + firstIndex, n * sizeof(jack_midi_event_t));
+    return n;
+}
+
+/* ============================================================================================ */
+
+uint32_t ljack_procbuf_write_midi_events(LjackProcBufUserData*    udata,
+                                         const jack_midi_event_t* events,
+                                         uint32_t                 count)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        jack_midi_data_t* b = ljack_procbuf_reserve_midi_event(udata, events[i].time, events[i].size);
+        if (!b) {
+            return i;
+        }
+        memcpy(b, events[i].buffer, events[i].size);
+    }
+    return count;
+}
+
+/* ============================================================================================ */
+
 jack_midi_data_t* ljack_procbuf_reserve_midi_event(LjackProcBufUserData*   udata,
                                                    jack_nframes_t          time,
                                                    size_t                  data_size)
@@ -79,6 +126,199 @@ jack_midi_data_t* ljack_procbuf_reserve_midi_event(LjackProcBufUserData*   udata
 
 /* ============================================================================================ */
 
+void ljack_procbuf_clear_segment(LjackMidiSegment* segment)
+{
+    segment->midiEventCount  = 0;
+    segment->midiEventsBegin = (jack_midi_event_t*)segment->buffer;
+    segment->midiEventsEnd   = segment->midiEventsBegin;
+    segment->midiDataBegin   = (jack_midi_data_t*)segment->buffer + segment->bufferLength;
+}
+
+static auproc_midibuf* segment_getMidiBuffer(LjackMidiSegment* segment, jack_nframes_t nframes)
+{
+    return (auproc_midibuf*) segment;
+}
+
+static uint32_t segment_getEventCount(LjackMidiSegment* segment)
+{
+    return segment->midiEventCount;
+}
+
+static int segment_getMidiEvent(jack_midi_event_t* event, LjackMidiSegment* segment, uint32_t event_index)
+{
+    jack_midi_event_t* e = segment->midiEventsBegin + event_index;
+    if (e < segment->midiEventsEnd) {
+        *event = *e;
+        return 0;
+    } else {
+        return ENODATA;
+    }
+}
+
+static jack_midi_data_t* segment_reserveMidiEvent(LjackMidiSegment* segment, jack_nframes_t time, size_t data_size)
+{
+    jack_midi_event_t* e    = segment->midiEventsEnd;
+    jack_midi_data_t*  eBuf = segment->midiDataBegin - data_size;
+    if ((unsigned char*)(e + 1) <= eBuf) {
+        e->time   = time;
+        e->size   = data_size;
+        e->buffer = eBuf;
+        segment->midiEventsEnd  += 1;
+        segment->midiDataBegin   = eBuf;
+        segment->midiEventCount += 1;
+        return eBuf;
+    } else {
+        return NULL;
+    }
+}
+
+static const jack_midi_event_t* segment_getMidiEventArray(LjackMidiSegment* segment, uint32_t* count)
+{
+    *count = segment->midiEventCount;
+    return segment->midiEventsBegin;
+}
+
+static uint32_t segment_getMidiEvents(jack_midi_event_t* events, LjackMidiSegment* segment,
+                                      uint32_t firstIndex, uint32_t maxCount)
+{
+    if (firstIndex >= segment->midiEventCount) {
+        return 0;
+    }
+    uint32_t n = segment->midiEventCount - firstIndex;
+    if (n > maxCount) {
+        n = maxCount;
+    }
+    memcpy(events, segment->midiEventsBegin + firstIndex, n * sizeof(jack_midi_event_t));
+    return n;
+}
+
+static uint32_t segment_writeMidiEvents(LjackMidiSegment* segment, const jack_midi_event_t* events, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        jack_midi_data_t* b = segment_reserveMidiEvent(segment, events[i].time, events[i].size);
+        if (!b) {
+            return i;
+        }
+        memcpy(b, events[i].buffer, events[i].size);
+    }
+    return count;
+}
+
+const auproc_midimeth ljack_procbuf_segment_midi_methods =
+{
+    (auproc_midibuf* (*)(auproc_connector*, uint32_t))                segment_getMidiBuffer,
+    (void            (*)(auproc_midibuf*))                            ljack_procbuf_clear_segment,
+    (uint32_t        (*)(auproc_midibuf*))                            segment_getEventCount,
+    (int             (*)(auproc_midi_event*, auproc_midibuf*, uint32_t)) segment_getMidiEvent,
+    (unsigned char*  (*)(auproc_midibuf*, uint32_t, size_t))          segment_reserveMidiEvent,
+    (const auproc_midi_event* (*)(auproc_midibuf*, uint32_t*))        segment_getMidiEventArray,
+    (uint32_t        (*)(auproc_midi_event*, auproc_midibuf*, uint32_t, uint32_t)) segment_getMidiEvents,
+    (uint32_t        (*)(auproc_midibuf*, const auproc_midi_event*, uint32_t))     segment_writeMidiEvents
+};
+
+/* merged events are written into the process buffer's own storage */
+static const auproc_midimeth mergeOutputMethods =
+{
+    NULL,
+    (void            (*)(auproc_midibuf*))                            ljack_procbuf_clear_midi_events,
+    (uint32_t        (*)(auproc_midibuf*))                            ljack_procbuf_get_midi_event_count,
+    (int             (*)(auproc_midi_event*, auproc_midibuf*, uint32_t)) ljack_procbuf_get_midi_event,
+    (unsigned char*  (*)(auproc_midibuf*, uint32_t, size_t))          ljack_procbuf_reserve_midi_event,
+    (const auproc_midi_event* (*)(auproc_midibuf*, uint32_t*))        ljack_procbuf_get_midi_event_array,
+    (uint32_t        (*)(auproc_midi_event*, auproc_midibuf*, uint32_t, uint32_t)) ljack_procbuf_get_midi_events,
+    (uint32_t        (*)(auproc_midibuf*, const auproc_midi_event*, uint32_t))     ljack_procbuf_write_midi_events
+};
+
+/* ============================================================================================ */
+
+bool ljack_procbuf_alloc_segments_LOCKED(LjackProcBufUserData* udata, LjackArena* arena,
+                                         int segmentCount, size_t bufferLength)
+{
+    LjackMidiSegment* segments = calloc(segmentCount, sizeof(LjackMidiSegment));
+    if (!segments) {
+        return false;
+    }
+    udata->segments     = segments;
+    udata->segmentCount = segmentCount;
+    for (int i = 0; i < segmentCount; ++i) {
+        LjackMidiSegment* s = segments + i;
+        s->procBuf   = udata;
+        s->arenaSlot = ljack_arena_alloc_LOCKED(arena, false, &s->buffer);
+        if (s->arenaSlot < 0) {
+            ljack_procbuf_free_segments_LOCKED(udata, arena);
+            return false;
+        }
+        s->bufferLength = bufferLength;
+        ljack_procbuf_clear_segment(s);
+    }
+    return true;
+}
+
+void ljack_procbuf_free_segments_LOCKED(LjackProcBufUserData* udata, LjackArena* arena)
+{
+    if (udata->segments) {
+        for (int i = 0; i < udata->segmentCount; ++i) {
+            LjackMidiSegment* s = udata->segments + i;
+            if (s->buffer) {
+                ljack_arena_free_LOCKED(arena, false, s->arenaSlot);
+            }
+        }
+        free(udata->segments);
+        udata->segments     = NULL;
+        udata->segmentCount = 0;
+    }
+}
+
+void ljack_procbuf_resize_segments_LOCKED(LjackProcBufUserData* udata, size_t bufferLength)
+{
+    for (int i = 0; i < udata->segmentCount; ++i) {
+        LjackMidiSegment* s = udata->segments + i;
+        s->bufferLength = bufferLength;
+        ljack_procbuf_clear_segment(s);
+    }
+}
+
+LjackMidiSegment* ljack_procbuf_acquire_segment(LjackProcBufUserData* udata)
+{
+    for (int i = 0; i < udata->segmentCount; ++i) {
+        LjackMidiSegment* s = udata->segments + i;
+        if (!atomic_get(&s->inUse)) {
+            ljack_procbuf_clear_segment(s);
+            atomic_set(&s->inUse, 1);
+            return s;
+        }
+    }
+    return NULL;
+}
+
+void ljack_procbuf_release_segment(LjackMidiSegment* segment)
+{
+    atomic_set(&segment->inUse, 0);
+}
+
+/* ============================================================================================ */
+
+void ljack_procbuf_merge_segments(LjackProcBufUserData* udata)
+{
+    if (udata->segmentCount == 0) {
+        return;
+    }
+    auproc_midibuf*        inBufs   [LJACK_MIDI_MERGE_MAX_INPUTS];
+    const auproc_midimeth* inMethods[LJACK_MIDI_MERGE_MAX_INPUTS];
+    int n = 0;
+    for (int i = 0; i < udata->segmentCount && n < LJACK_MIDI_MERGE_MAX_INPUTS; ++i) {
+        LjackMidiSegment* s = udata->segments + i;
+        if (atomic_get(&s->inUse)) {
+            inBufs[n]    = (auproc_midibuf*) s;
+            inMethods[n] = &ljack_procbuf_segment_midi_methods;
+            ++n;
+        }
+    }
+    ljack_midi_merge((auproc_midibuf*) udata, &mergeOutputMethods, inBufs, inMethods, n);
+}
+
+/* ============================================================================================ */
+
 static void setupProcBufMeta(lua_State* L);
 
 static int pushProcBufMeta(lua_State* L)
@@ -96,6 +336,8 @@ ProcBufUserData* ljack_procbuf_create(lua_State* L)
     ProcBufUserData* udata = lua_newuserdata(L, sizeof(ProcBufUserData));
     memset(udata, 0, sizeof(ProcBufUserData));        /* -> udata */
     udata->nameRef = LUA_NOREF;
+    udata->aliasPortRef = LUA_NOREF;
+    udata->arenaSlot    = -1;
     pushProcBufMeta(L);                               /* -> udata, meta */
 
     const char* procBufName = lua_pushfstring(L, "%s: %p", LJACK_PROCBUF_CLASS_NAME, udata);
@@ -109,15 +351,24 @@ ProcBufUserData* ljack_procbuf_create(lua_State* L)
 
 /* ============================================================================================ */
 
-void ljack_procbuf_release(lua_State* L, ProcBufUserData* udata)
+static void freeStorage(ProcBufUserData* udata)
 {
-    if (udata->ringBuffer) {
-        jack_ringbuffer_free(udata->ringBuffer);
-        udata->ringBuffer = NULL;
+    if (udata->segments) {
+        ljack_procbuf_free_segments_LOCKED(udata, &udata->clientUserData->arena);
+    }
+    if (udata->arenaSlot >= 0) {
+        ljack_arena_free_LOCKED(&udata->clientUserData->arena, udata->isAudio, udata->arenaSlot);
+        udata->arenaSlot = -1;
     }
+    udata->buffer = NULL;
+}
+
+void ljack_procbuf_release(lua_State* L, ProcBufUserData* udata)
+{
     if (udata->processMutex) {
         async_mutex_lock(udata->processMutex);
         {
+            freeStorage(udata);
             if (udata->prevNextProcBufUserData) {
                 *udata->prevNextProcBufUserData = udata->nextProcBufUserData;
                 if (udata->nextProcBufUserData) {
@@ -127,6 +378,14 @@ void ljack_procbuf_release(lua_State* L, ProcBufUserData* udata)
         }
         async_mutex_unlock(udata->processMutex);
         udata->processMutex = NULL;
+    } else {
+        freeStorage(udata);
+    }
+    if (udata->aliasPortRef != LUA_NOREF) {
+        udata->aliasPort->procUsageCounter -= 1;
+        luaL_unref(L, LUA_REGISTRYINDEX, udata->aliasPortRef);
+        udata->aliasPortRef = LUA_NOREF;
+        udata->aliasPort    = NULL;
     }
     if (udata->nameRef != LUA_NOREF) {
         luaL_unref(L, LUA_REGISTRYINDEX, udata->nameRef);
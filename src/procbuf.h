@@ -8,6 +8,7 @@
 #include "util.h"
 #include "client.h"
 #include "auproc_capi.h"
+#include "client_arena.h"
 
 extern const char* const LJACK_PROCBUF_CLASS_NAME;
 
@@ -15,6 +16,30 @@ struct LjackClientUserData;
 
 /* ============================================================================================ */
 
+/**
+ * Preallocated storage of one writer of a MIDI process buffer with multiple writers.
+ * The events of all segments are merged into the process buffer's storage when the 
+ * process buffer is read for the first time in a process cycle.
+ */
+typedef struct LjackMidiSegment
+{
+    struct LjackProcBufUserData* procBuf;
+    
+    char*              buffer;            /* storage in the client's arena, like the process buffer's */
+    int                arenaSlot;
+    size_t             bufferLength;      /* used bytes for the current buffer size */
+    
+    uint32_t           midiEventCount;
+    jack_midi_event_t* midiEventsBegin;
+    jack_midi_event_t* midiEventsEnd;
+    jack_midi_data_t*  midiDataBegin;
+    
+    AtomicCounter      inUse;             /* assigned to the connector of a registered processor */
+
+} LjackMidiSegment;
+
+/* ============================================================================================ */
+
 typedef struct LjackProcBufUserData
 {
     const char*        className;
@@ -23,7 +48,9 @@ typedef struct LjackProcBufUserData
     const char*        procBufName;
     int                nameRef;
     
-    jack_ringbuffer_t* ringBuffer;
+    char*              buffer;            /* storage in the client's arena, capacity for the client's maximum buffer size */
+    int                arenaSlot;         /* -1 if there is no storage of its own */
+    size_t             bufferLength;      /* used bytes for the current buffer size */
     
     uint32_t           midiEventCount;
     jack_midi_event_t* midiEventsBegin;
@@ -34,6 +61,9 @@ typedef struct LjackProcBufUserData
     bool               isMidi;
     bool               isAudio;
 
+    struct LjackPortUserData* aliasPort;  /* own port whose buffer is used instead of storage */
+    int                       aliasPortRef;
+
     int              procUsageCounter;
     
     int              inpUsageCounter;
@@ -42,6 +72,19 @@ typedef struct LjackProcBufUserData
     int              inpActiveCounter;
     int              outActiveCounter;
     
+    int              schedWriterCounter; /* only used while sorting processors */
+    
+    uint32_t         silentCycle;        /* process cycle in which the buffer was marked as silent */
+    
+    int               segmentCount;      /* > 0 for MIDI process buffers with multiple writers */
+    LjackMidiSegment* segments;
+    
+    jack_latency_range_t latencyRange;   /* only used in the latency callback */
+    bool                 latencyValid;
+    
+    bool             sharedStorage;      /* buffer is assigned by the exec list */
+    int              storageIndex;       /* only used while assigning storage */
+    
     AtomicCounter*   shutdownReceived;
     Mutex*           processMutex;
 
@@ -76,11 +119,62 @@ int ljack_procbuf_get_midi_event(jack_midi_event_t*  event,
                                  
 /* ============================================================================================ */
 
+const jack_midi_event_t* ljack_procbuf_get_midi_event_array(LjackProcBufUserData* udata,
+                                                            uint32_t*             count);
+
+uint32_t ljack_procbuf_get_midi_events(jack_midi_event_t*    events,
+                                       LjackProcBufUserData* udata,
+                                       uint32_t              firstIndex,
+                                       uint32_t              maxCount);
+
+uint32_t ljack_procbuf_write_midi_events(LjackProcBufUserData*    udata,
+                                         const jack_midi_event_t* events,
+                                         uint32_t                 count);
+
+/* ============================================================================================ */
+
 jack_midi_data_t* ljack_procbuf_reserve_midi_event(LjackProcBufUserData*   udata,
                                                    jack_nframes_t          time,
                                                    size_t                  data_size);
 
 /* ============================================================================================ */
 
+/**
+ * MIDI methods for the segments of a process buffer with multiple writers.
+ */
+extern const auproc_midimeth ljack_procbuf_segment_midi_methods;
+
+/**
+ * Allocates the segments' storage in the client's arena, i.e. the storage is resized
+ * together with the storage of the process buffers in the buffer size callback.
+ */
+bool ljack_procbuf_alloc_segments_LOCKED(LjackProcBufUserData* udata, LjackArena* arena,
+                                         int segmentCount, size_t bufferLength);
+
+void ljack_procbuf_free_segments_LOCKED(LjackProcBufUserData* udata, LjackArena* arena);
+
+/**
+ * Is called in the buffer size callback after the arena was resized.
+ */
+void ljack_procbuf_resize_segments_LOCKED(LjackProcBufUserData* udata, size_t bufferLength);
+
+/**
+ * Gives a segment that is not used by another writer or NULL.
+ */
+LjackMidiSegment* ljack_procbuf_acquire_segment(LjackProcBufUserData* udata);
+
+void ljack_procbuf_release_segment(LjackMidiSegment* segment);
+
+void ljack_procbuf_clear_segment(LjackMidiSegment* segment);
+
+/**
+ * Merges the segments into the process buffer's storage. Does nothing for process 
+ * buffers without segments. Is called in the process thread before the first level
+ * of the exec list that reads the process buffer is invoked.
+ */
+void ljack_procbuf_merge_segments(LjackProcBufUserData* udata);
+
+/* ============================================================================================ */
+
 
 #endif /* LJACK_PROCBUF_H */
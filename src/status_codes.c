@@ -0,0 +1,73 @@
+#include "util.h"
+#include "receiver_capi.h"
+
+#include "status_codes.h"
+
+/* ============================================================================================ */
+
+typedef struct StatusName
+{
+    const char* name;
+    size_t      length;
+} StatusName;
+
+#define STATUS_NAME(s) { s, sizeof(s) - 1 }
+
+/* indexed by LjackStatusCode */
+static const StatusName statusNames[] =
+{
+    { NULL, 0 },
+    STATUS_NAME("ClientRegistration"),
+    STATUS_NAME("GraphOrder"),
+    STATUS_NAME("PortConnect"),
+    STATUS_NAME("PortRegistration"),
+    STATUS_NAME("PortRename"),
+    STATUS_NAME("BufferSize"),
+    STATUS_NAME("Shutdown"),
+    STATUS_NAME("XRun"),
+    STATUS_NAME("ProcessingError"),
+    STATUS_NAME("ConnectionsApplied"),
+    STATUS_NAME("PortRegistrations"),
+    STATUS_NAME("PortConnects")
+};
+
+#define STATUS_NAME_COUNT ((int)(sizeof(statusNames) / sizeof(statusNames[0])))
+
+/* ============================================================================================ */
+
+const char* ljack_status_name(LjackStatusCode code)
+{
+    if (code > 0 && code < STATUS_NAME_COUNT) {
+        return statusNames[code].name;
+    }
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+void ljack_status_add_type(const receiver_capi* capi, receiver_writer* writer, bool compact,
+                           LjackStatusCode code)
+{
+    if (compact) {
+        capi->addIntegerToWriter(writer, code);
+    } else {
+        capi->addStringToWriter(writer, statusNames[code].name, statusNames[code].length);
+    }
+}
+
+/* ============================================================================================ */
+
+int ljack_status_codes_init_module(lua_State* L, int module)
+{
+    lua_newtable(L);                                        /* -> codes */
+    for (int code = 1; code < STATUS_NAME_COUNT; ++code) {
+        lua_pushinteger(L, code);                           /* -> codes, code */
+        lua_setfield(L, -2, statusNames[code].name);        /* -> codes */
+        lua_pushstring(L, statusNames[code].name);          /* -> codes, name */
+        lua_rawseti(L, -2, code);                           /* -> codes */
+    }
+    lua_setfield(L, module, "status_codes");                /* -> */
+    return 0;
+}
+
+/* ============================================================================================ */
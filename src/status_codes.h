@@ -0,0 +1,44 @@
+#ifndef LJACK_STATUS_CODES_H
+#define LJACK_STATUS_CODES_H
+
+#include "util.h"
+#include "receiver_capi.h"
+
+/* ============================================================================================ */
+
+/**
+ * Integer codes of the status message types. If the client option compact_status
+ * is given, status messages start with these codes instead of the type names.
+ * The values are part of the public API, see ljack.status_codes.
+ */
+
+typedef enum LjackStatusCode
+{
+    LJACK_STATUS_CLIENT_REGISTRATION = 1,
+    LJACK_STATUS_GRAPH_ORDER         = 2,
+    LJACK_STATUS_PORT_CONNECT        = 3,
+    LJACK_STATUS_PORT_REGISTRATION   = 4,
+    LJACK_STATUS_PORT_RENAME         = 5,
+    LJACK_STATUS_BUFFER_SIZE         = 6,
+    LJACK_STATUS_SHUTDOWN            = 7,
+    LJACK_STATUS_XRUN                = 8,
+    LJACK_STATUS_PROCESSING_ERROR    = 9,
+    LJACK_STATUS_CONNECTIONS_APPLIED = 10,
+    LJACK_STATUS_PORT_REGISTRATIONS  = 11,
+    LJACK_STATUS_PORT_CONNECTS       = 12
+
+} LjackStatusCode;
+
+const char* ljack_status_name(LjackStatusCode code);
+
+/**
+ * Adds the message type as integer code if compact is true, otherwise as type name.
+ */
+void ljack_status_add_type(const receiver_capi* capi, receiver_writer* writer, bool compact,
+                           LjackStatusCode code);
+
+int ljack_status_codes_init_module(lua_State* L, int module);
+
+/* ============================================================================================ */
+
+#endif /* LJACK_STATUS_CODES_H */